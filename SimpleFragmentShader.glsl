@@ -1,5 +1,10 @@
 #version 330 core
 
+// Variants the loader compiles, see common/shadervariants.hpp. The light
+// count is the smallest one that covers the level's lights.
+#pragma permutation NUM_LIGHTS 0 1 2 3 4
+#pragma permutation INSTANCED
+
 out vec4 FragColor;
 
 struct Light {
@@ -11,21 +16,42 @@ struct Light {
 in vec3 FragPos;
 in vec3 Normal;
 
-#define NUM_LIGHTS 4
-uniform Light lights[NUM_LIGHTS];
-uniform int numLights;
+#ifdef INSTANCED
+in vec3 InstanceColor;
+#endif
+
+// Shared by every program, uploaded once per frame (LightsBlock in
+// common/uniformblocks.hpp). MAX_LIGHTS must match MaxLights.
+#define MAX_LIGHTS 4
+layout(std140) uniform Lights {
+    Light lights[MAX_LIGHTS];
+    int numLights;
+};
+
 uniform vec3 objectColor;
 
 void main() {
+#ifdef INSTANCED
+    vec3 color = objectColor * InstanceColor;
+#else
+    vec3 color = objectColor;
+#endif
+
     vec3 norm = normalize(Normal);
     vec3 result = vec3(0.0);
 
+    // A compile-time light count lets the loop unroll, programs built
+    // without one loop over the uploaded count
+#ifdef NUM_LIGHTS
+    for (int i = 0; i < NUM_LIGHTS; ++i) {
+#else
     for (int i = 0; i < numLights; ++i) {
+#endif
         vec3 lightDir = normalize(lights[i].position - FragPos);
         float diff = max(dot(norm, lightDir), 0.0);
         vec3 diffuse = diff * lights[i].color;
-        vec3 ambient = lights[i].intensity * objectColor;
-        result += (ambient + diffuse) * objectColor;
+        vec3 ambient = lights[i].intensity * color;
+        result += (ambient + diffuse) * color;
     }
 
     FragColor = vec4(result, 1.0);
@@ -1,23 +1,78 @@
 #version 330 core
 
+// Variants the loader compiles, see common/shadervariants.hpp
+#pragma permutation QUANTIZED_VERTICES
+#pragma permutation INSTANCED
+
 // Input vertex data, different for all executions of this shader.
 layout(location = 0) in vec3 vertexPosition_modelspace;
+
+#ifdef QUANTIZED_VERTICES
+// Position is unorm16 relative to the mesh bounds, normal is octahedral snorm16
+layout(location = 1) in vec2 aNormal;
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#else
 layout(location = 1) in vec3 aNormal;
+#endif
+
+#ifdef INSTANCED
+// Per-instance transform and color, relative to the model entry
+layout(location = 2) in mat4 instanceModel;
+layout(location = 6) in vec3 instanceColor;
+
+out vec3 InstanceColor;
+#endif
 
 out vec3 FragPos;   // Pass fragment position to fragment shader
 out vec3 Normal;    // Pass normal vector to fragment shader
 
-uniform mat4 view;
-uniform mat4 projection;
+// Shared by every program, uploaded once per frame (CameraBlock in
+// common/uniformblocks.hpp)
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+};
+
 uniform mat4 model;
+// Inverse transpose of model's upper 3x3, composed by the scene graph
+uniform mat3 normalMatrix;
 
 void main(){
 
+#ifdef QUANTIZED_VERTICES
+    vec3 position = positionOffset + vertexPosition_modelspace * positionScale;
+    vec3 normal = decodeOctahedral(aNormal);
+#else
+    vec3 position = vertexPosition_modelspace;
+    vec3 normal = aNormal;
+#endif
+
+#ifdef INSTANCED
+    mat4 world = model * instanceModel;
+    // Instances are only rotated and translated, so their upper 3x3 is
+    // its own inverse transpose
+    mat3 worldNormal = normalMatrix * mat3(instanceModel);
+    InstanceColor = instanceColor;
+#else
+    mat4 world = model;
+    mat3 worldNormal = normalMatrix;
+#endif
+
     // Transform vertex position to world coordinates
-    FragPos = mat3(transpose(inverse(model))) * vertexPosition_modelspace;
+    FragPos = worldNormal * position;
 
     // Transform normal to world coordinates (no translation)
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = worldNormal * normal;
     
-    gl_Position = projection * view * model * vec4(vertexPosition_modelspace, 1.0);
+    gl_Position = projection * view * world * vec4(position, 1.0);
 }
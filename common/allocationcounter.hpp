@@ -0,0 +1,12 @@
+#include <cstddef>
+
+#ifndef ALLOCATIONCOUNTER_HPP
+#define ALLOCATIONCOUNTER_HPP
+
+// Number of global operator new calls since startup, from every thread.
+// Sample it at the start and end of a frame to count that frame's heap
+// allocations. Allocations made with malloc by C libraries and drivers
+// are not included.
+size_t getAllocationCount();
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+// Axis aligned bounding box
+struct Bounds {
+    float min[3];
+    float max[3];
+};
+
+#endif
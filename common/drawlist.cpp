@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "drawlist.hpp"
+
+uint64_t makeSortKey(uint32_t programID, uint32_t vao, float depth, float farPlane) {
+    const uint64_t depthMax = (1ull << SortKeyDepthBits) - 1;
+    float normalized = std::min(std::max(depth / farPlane, 0.0f), 1.0f);
+    uint64_t depthBits = (uint64_t)(normalized * (float)depthMax);
+    uint64_t programBits = programID & ((1ull << SortKeyProgramBits) - 1);
+    uint64_t vaoBits = vao & ((1ull << SortKeyVaoBits) - 1);
+    return (programBits << (SortKeyVaoBits + SortKeyDepthBits)) | (vaoBits << SortKeyDepthBits) | depthBits;
+}
+
+DrawList::DrawList() : _sortPasses(0) {
+}
+
+void DrawList::clear() {
+    _commands.clear();
+}
+
+void DrawList::reserve(size_t count) {
+    _commands.reserve(count);
+    _scratch.reserve(count);
+}
+
+void DrawList::add(uint64_t key, uint32_t item) {
+    DrawCommand command = { key, item };
+    _commands.push_back(command);
+}
+
+void DrawList::sort() {
+    _sortPasses = 0;
+    size_t count = _commands.size();
+    if (count < 2) {
+        return;
+    }
+    _scratch.resize(count);
+
+    // All eight histograms in one read of the keys
+    size_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (const DrawCommand& command : _commands) {
+        uint64_t key = command.key;
+        for (int digit = 0; digit < 8; digit++) {
+            histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    DrawCommand* source = _commands.data();
+    DrawCommand* target = _scratch.data();
+    for (int digit = 0; digit < 8; digit++) {
+        size_t* histogram = histograms[digit];
+        int shift = digit * 8;
+        if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++) {
+            size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+        std::swap(source, target);
+        _sortPasses++;
+    }
+
+    // An odd number of passes leaves the result in the scratch array
+    if (source != _commands.data()) {
+        _commands.swap(_scratch);
+    }
+}
+
+int DrawList::getSortPasses() const {
+    return _sortPasses;
+}
+
+size_t DrawList::size() const {
+    return _commands.size();
+}
+
+const std::vector<DrawCommand>& DrawList::getCommands() const {
+    return _commands;
+}
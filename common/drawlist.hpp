@@ -0,0 +1,50 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef DRAWLIST_HPP
+#define DRAWLIST_HPP
+
+// One visible item, ordered by its key
+struct DrawCommand {
+    uint64_t key;
+    uint32_t item;      // Index into the render items
+};
+
+// Sort key bits, most significant first: program, VAO, then view depth
+// front to back so items sharing state draw in early-z friendly order.
+// GL names are small integers, larger ones wrap and only cost extra binds.
+static const int SortKeyProgramBits = 16;
+static const int SortKeyVaoBits = 24;
+static const int SortKeyDepthBits = 24;
+
+// depth is the view-space distance, clamped to [0, farPlane]
+uint64_t makeSortKey(uint32_t programID, uint32_t vao, float depth, float farPlane);
+
+// Per-frame list of draws, sorted by key so consecutive draws share their
+// program and VAO. The arrays keep their capacity between frames, so
+// steady-state frames do not allocate.
+class DrawList {
+public:
+    DrawList();
+
+    void clear();
+    void reserve(size_t count);
+    void add(uint64_t key, uint32_t item);
+
+    // Stable LSD radix sort on 8-bit digits. Digits that are the same in
+    // every key are skipped, usually the high program and VAO bytes.
+    void sort();
+    // Radix passes the last sort() made, out of 8
+    int getSortPasses() const;
+
+    size_t size() const;
+    const std::vector<DrawCommand>& getCommands() const;
+
+private:
+    std::vector<DrawCommand> _commands;
+    std::vector<DrawCommand> _scratch;
+    int _sortPasses;
+};
+
+#endif
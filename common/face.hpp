@@ -1,3 +1,6 @@
+#include <cstddef>
+#include <cstdint>
+
 #ifndef FACE_HPP
 #define FACE_HPP
 
@@ -5,4 +8,10 @@ struct Face {
     unsigned int v1, v2, v3;
 };
 
-#endif
\ No newline at end of file
+// Bytes per index of the upload array, every index of a mesh under 65536
+// vertices fits in 16 bits
+inline size_t indexSize(size_t vertexCount) {
+    return vertexCount < 65536 ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+#endif
@@ -0,0 +1,14 @@
+#include <cstddef>
+
+#include "glcallcounter.hpp"
+
+// Only the GL thread issues calls, no atomics needed
+static size_t glCallCount = 0;
+
+void countGLCall() {
+    glCallCount++;
+}
+
+size_t getGLCallCount() {
+    return glCallCount;
+}
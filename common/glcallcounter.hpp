@@ -0,0 +1,14 @@
+#include <cstddef>
+
+#ifndef GLCALLCOUNTER_HPP
+#define GLCALLCOUNTER_HPP
+
+// Counts GL calls made through GL_COUNTED, sample it at the start and end
+// of a frame like getAllocationCount(). Calls made without the macro, e.g.
+// by the ImGui backend, are not included.
+void countGLCall();
+size_t getGLCallCount();
+
+#define GL_COUNTED(call) (countGLCall(), call)
+
+#endif
@@ -0,0 +1,84 @@
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "bounds.hpp"
+#include "mesh.hpp"
+#include "lvlparser.hpp"
+
+#include "instancebuffer.hpp"
+
+InstanceBuffer::InstanceBuffer(const Mesh& mesh, const std::vector<LevelInstance>& instances)
+    : vao(0), vbo(0), _instanceCount(instances.size()), _boundsCenter(0.0f), _boundsRadius(0.0f) {
+    const Bounds& bounds = mesh.objLoader.getBounds();
+    glm::vec3 minimum(bounds.min[0], bounds.min[1], bounds.min[2]);
+    glm::vec3 maximum(bounds.max[0], bounds.max[1], bounds.max[2]);
+    glm::vec3 meshCenter = (minimum + maximum) * 0.5f;
+    float meshRadius = glm::length(maximum - minimum) * 0.5f;
+
+    // Same transform as Object::getModelMatrix, the group bounds enclose
+    // the mesh sphere around each instance
+    std::vector<InstanceData> data(instances.size());
+    glm::vec3 lower(0.0f);
+    glm::vec3 upper(0.0f);
+    for (size_t i = 0; i < instances.size(); i++) {
+        const LevelInstance& instance = instances[i];
+        glm::mat4 translationMatrix = glm::translate(glm::vec3(instance.x, instance.y, instance.z));
+        glm::mat4 rotationMatrix = glm::rotate(instance.angle, glm::vec3(0.0f, 1.0f, 0.0f));
+        data[i].model = translationMatrix * rotationMatrix;
+        data[i].color = instance.color;
+
+        glm::vec3 center = glm::vec3(data[i].model * glm::vec4(meshCenter, 1.0f));
+        lower = i == 0 ? center : glm::min(lower, center);
+        upper = i == 0 ? center : glm::max(upper, center);
+    }
+    _boundsCenter = (lower + upper) * 0.5f;
+    _boundsRadius = glm::length(upper - lower) * 0.5f + meshRadius;
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    mesh.bindVertexAttributes();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(InstanceData), data.data(), GL_STATIC_DRAW);
+
+    // A mat4 attribute takes four vec4 locations
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(2 + column);
+        glVertexAttribDivisor(2 + column, 1);
+    }
+    glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, color));
+    glEnableVertexAttribArray(6);
+    glVertexAttribDivisor(6, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+InstanceBuffer::~InstanceBuffer() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+}
+
+size_t InstanceBuffer::getInstanceCount() const {
+    return _instanceCount;
+}
+
+size_t InstanceBuffer::getBufferBytes() const {
+    return _instanceCount * sizeof(InstanceData);
+}
+
+const glm::vec3& InstanceBuffer::getBoundsCenter() const {
+    return _boundsCenter;
+}
+
+float InstanceBuffer::getBoundsRadius() const {
+    return _boundsRadius;
+}
@@ -0,0 +1,44 @@
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "lvlparser.hpp"
+
+#ifndef INSTANCEBUFFER_HPP
+#define INSTANCEBUFFER_HPP
+
+class Mesh;
+
+// Per-instance transforms and colors of one instanced level model, drawn
+// with a single glDrawElementsInstanced. Owns a VAO that reads the mesh's
+// vertex and element buffers plus the instance buffer: the model matrix
+// at attribute locations 2-5 and the color at 6, advancing per instance.
+class InstanceBuffer {
+public:
+    InstanceBuffer(const Mesh& mesh, const std::vector<LevelInstance>& instances);
+    ~InstanceBuffer();
+
+    // Layout of one instance in the buffer
+    struct InstanceData {
+        glm::mat4 model;
+        glm::vec3 color;
+    };
+
+    size_t getInstanceCount() const;
+    size_t getBufferBytes() const;
+
+    // Bounding sphere around every instance, in the model entry's space
+    const glm::vec3& getBoundsCenter() const;
+    float getBoundsRadius() const;
+
+    GLuint vao;
+    GLuint vbo;
+private:
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    size_t _instanceCount;
+    glm::vec3 _boundsCenter;
+    float _boundsRadius;
+};
+
+#endif
@@ -3,6 +3,9 @@
 #ifndef LIGHT_HPP
 #define LIGHT_HPP
 
+// Size of the lights array in SimpleFragmentShader.glsl
+const int MaxLights = 4;
+
 class Light {
 public:
     glm::vec3 position; // Position of the light in world coordinates
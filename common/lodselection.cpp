@@ -0,0 +1,25 @@
+#include <glm/glm.hpp>
+
+#include "lodselection.hpp"
+
+size_t selectLod(const glm::vec3& center, float radius, size_t lodCount,
+                 const glm::vec3& cameraPosition, float projectionScale) {
+    if (lodCount <= 1) {
+        return 0;
+    }
+
+    // Fraction of half the screen height covered by the bounding sphere
+    float distance = glm::length(center - cameraPosition);
+    if (distance <= radius) {
+        return 0;
+    }
+    float screenSize = radius * projectionScale / distance;
+
+    size_t lod = 0;
+    float threshold = 0.5f;
+    while (lod + 1 < lodCount && screenSize < threshold) {
+        lod++;
+        threshold *= 0.5f;
+    }
+    return lod;
+}
@@ -0,0 +1,14 @@
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#ifndef LODSELECTION_HPP
+#define LODSELECTION_HPP
+
+// Picks one of lodCount levels of detail from the projected size of a
+// world space bounding sphere, projectionScale is 1 / tan(fovY / 2). Each
+// level halves the size. Needs no GL, so tools make the same choice as
+// the draw loop.
+size_t selectLod(const glm::vec3& center, float radius, size_t lodCount,
+                 const glm::vec3& cameraPosition, float projectionScale);
+
+#endif
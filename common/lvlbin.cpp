@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "mappedfile.hpp"
+#include "meshbin.hpp"
+#include "lvlparser.hpp"
+#include "light.hpp"
+
+#include "lvlbin.hpp"
+
+static const char levelBinMagic[8] = { 'L', 'E', 'V', 'E', 'L', 'B', 'I', 'N' };
+
+static inline uint64_t alignTo16(uint64_t offset) {
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+// Deduplicated NUL terminated strings, referenced by byte offset
+class StringTable {
+public:
+    uint32_t add(const std::string& value) {
+        std::map<std::string, uint32_t>::iterator it = _offsets.find(value);
+        if (it != _offsets.end()) {
+            return it->second;
+        }
+        uint32_t offset = (uint32_t)_data.size();
+        _data.insert(_data.end(), value.begin(), value.end());
+        _data.push_back('\0');
+        _offsets[value] = offset;
+        return offset;
+    }
+
+    const std::vector<char>& getData() const {
+        return _data;
+    }
+
+private:
+    std::vector<char> _data;
+    std::map<std::string, uint32_t> _offsets;
+};
+
+bool isLevelBinPath(const std::string& filePath) {
+    const std::string extension = ".lvlbin";
+    return filePath.size() >= extension.size()
+        && filePath.compare(filePath.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+static bool writeBlock(FILE* file, const void* data, uint64_t size, uint64_t offset, uint64_t& position) {
+    static const char padding[16] = { 0 };
+    if (offset - position > 0 && fwrite(padding, 1, offset - position, file) != offset - position) {
+        return false;
+    }
+    if (size > 0 && fwrite(data, 1, size, file) != size) {
+        return false;
+    }
+    position = offset + size;
+    return true;
+}
+
+bool writeLevelBin(const std::string& filePath, const std::string& name,
+    const std::vector<LevelModel>& models, const std::vector<Light>& lights) {
+    StringTable strings;
+    uint32_t nameOffset = strings.add(name);
+
+    // One mesh entry per distinct file, shaders and options
+    std::vector<LevelBinMesh> meshes;
+    std::map<std::string, uint32_t> meshIndices;
+    std::vector<uint32_t> modelMeshes;
+    std::vector<LevelBinTransform> transforms;
+    std::vector<LevelBinColor> colors;
+    std::vector<LevelBinInstanceRange> instanceRanges;
+    std::vector<LevelBinTransform> instanceTransforms;
+    std::vector<LevelBinColor> instanceColors;
+    std::vector<LevelBinNode> nodes;
+    for (const LevelModel& model : models) {
+        if (!model.load) {
+            continue;
+        }
+
+        LevelBinMesh mesh;
+        memset(&mesh, 0, sizeof(mesh));
+        mesh.fileName = strings.add(model.fileName);
+        mesh.vertexShader = strings.add(model.vertexShader);
+        mesh.fragmentShader = strings.add(model.fragmentShader);
+        mesh.vertexFormat = model.options.vertexFormat;
+        mesh.retention = model.options.retention;
+        mesh.collisionRatio = model.options.collisionRatio;
+        mesh.lodCount = (uint32_t)std::min(model.options.lodRatios.size(), MaxMeshLods - 1);
+        for (uint32_t i = 0; i < mesh.lodCount; i++) {
+            mesh.lodRatios[i] = model.options.lodRatios[i];
+        }
+
+        std::string key((const char*)&mesh, sizeof(mesh));
+        std::map<std::string, uint32_t>::iterator it = meshIndices.find(key);
+        if (it == meshIndices.end()) {
+            it = meshIndices.insert(std::make_pair(key, (uint32_t)meshes.size())).first;
+            meshes.push_back(mesh);
+        }
+        modelMeshes.push_back(it->second);
+
+        LevelBinTransform transform = { model.x, model.y, model.z, model.angle };
+        transforms.push_back(transform);
+        LevelBinColor color = { model.color.r, model.color.g, model.color.b };
+        colors.push_back(color);
+        LevelBinNode node = { strings.add(model.name), strings.add(model.parent) };
+        nodes.push_back(node);
+
+        LevelBinInstanceRange range = { (uint32_t)instanceTransforms.size(), (uint32_t)model.instances.size() };
+        instanceRanges.push_back(range);
+        for (const LevelInstance& instance : model.instances) {
+            LevelBinTransform instanceTransform = { instance.x, instance.y, instance.z, instance.angle };
+            instanceTransforms.push_back(instanceTransform);
+            LevelBinColor instanceColor = { instance.color.r, instance.color.g, instance.color.b };
+            instanceColors.push_back(instanceColor);
+        }
+    }
+
+    std::vector<LevelBinLight> packedLights;
+    for (const Light& light : lights) {
+        LevelBinLight packed = {
+            { light.position.x, light.position.y, light.position.z },
+            { light.color.r, light.color.g, light.color.b },
+            light.intensity
+        };
+        packedLights.push_back(packed);
+    }
+
+    LevelBinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, levelBinMagic, sizeof(levelBinMagic));
+    header.version = LevelBinVersion;
+    header.name = nameOffset;
+    header.meshCount = (uint32_t)meshes.size();
+    header.modelCount = (uint32_t)modelMeshes.size();
+    header.lightCount = (uint32_t)packedLights.size();
+    header.instanceCount = (uint32_t)instanceTransforms.size();
+    header.stringsOffset = alignTo16(sizeof(LevelBinHeader));
+    header.stringsSize = strings.getData().size();
+    header.meshesOffset = alignTo16(header.stringsOffset + header.stringsSize);
+    header.modelMeshesOffset = alignTo16(header.meshesOffset + meshes.size() * sizeof(LevelBinMesh));
+    header.transformsOffset = alignTo16(header.modelMeshesOffset + modelMeshes.size() * sizeof(uint32_t));
+    header.colorsOffset = alignTo16(header.transformsOffset + transforms.size() * sizeof(LevelBinTransform));
+    header.lightsOffset = alignTo16(header.colorsOffset + colors.size() * sizeof(LevelBinColor));
+    header.instanceRangesOffset = alignTo16(header.lightsOffset + packedLights.size() * sizeof(LevelBinLight));
+    header.instanceTransformsOffset = alignTo16(header.instanceRangesOffset + instanceRanges.size() * sizeof(LevelBinInstanceRange));
+    header.instanceColorsOffset = alignTo16(header.instanceTransformsOffset + instanceTransforms.size() * sizeof(LevelBinTransform));
+    header.nodesOffset = alignTo16(header.instanceColorsOffset + instanceColors.size() * sizeof(LevelBinColor));
+
+    // Write to a temporary file and rename it so readers never see half a file
+    static std::atomic<unsigned int> writeCount(0);
+    std::string tempPath = filePath + ".tmp." + std::to_string(getpid()) + "." + std::to_string(writeCount++);
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error writing level: " << tempPath << std::endl;
+        return false;
+    }
+
+    uint64_t position = 0;
+    bool ok = writeBlock(file, &header, sizeof(header), 0, position)
+        && writeBlock(file, strings.getData().data(), header.stringsSize, header.stringsOffset, position)
+        && writeBlock(file, meshes.data(), meshes.size() * sizeof(LevelBinMesh), header.meshesOffset, position)
+        && writeBlock(file, modelMeshes.data(), modelMeshes.size() * sizeof(uint32_t), header.modelMeshesOffset, position)
+        && writeBlock(file, transforms.data(), transforms.size() * sizeof(LevelBinTransform), header.transformsOffset, position)
+        && writeBlock(file, colors.data(), colors.size() * sizeof(LevelBinColor), header.colorsOffset, position)
+        && writeBlock(file, packedLights.data(), packedLights.size() * sizeof(LevelBinLight), header.lightsOffset, position)
+        && writeBlock(file, instanceRanges.data(), instanceRanges.size() * sizeof(LevelBinInstanceRange), header.instanceRangesOffset, position)
+        && writeBlock(file, instanceTransforms.data(), instanceTransforms.size() * sizeof(LevelBinTransform), header.instanceTransformsOffset, position)
+        && writeBlock(file, instanceColors.data(), instanceColors.size() * sizeof(LevelBinColor), header.instanceColorsOffset, position)
+        && writeBlock(file, nodes.data(), nodes.size() * sizeof(LevelBinNode), header.nodesOffset, position);
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        std::cerr << "Error writing level: " << filePath << std::endl;
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Checks that an array lies inside the mapping and is aligned
+static bool validArray(const MappedFile& file, uint64_t offset, uint64_t count, uint64_t stride) {
+    return offset % 16 == 0 && offset <= file.getSize() && count <= (file.getSize() - offset) / stride;
+}
+
+bool loadLevelBin(const std::string& filePath, LevelSink& sink) {
+    MappedFile file;
+    if (!file.open(filePath)) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return false;
+    }
+
+    const LevelBinHeader* header = (const LevelBinHeader*)file.getData();
+    if (file.getSize() < sizeof(LevelBinHeader)
+        || memcmp(header->magic, levelBinMagic, sizeof(levelBinMagic)) != 0
+        || header->version != LevelBinVersion
+        || header->stringsSize == 0
+        || !validArray(file, header->stringsOffset, header->stringsSize, 1)
+        || file.getData()[header->stringsOffset + header->stringsSize - 1] != '\0'
+        || header->name >= header->stringsSize
+        || !validArray(file, header->meshesOffset, header->meshCount, sizeof(LevelBinMesh))
+        || !validArray(file, header->modelMeshesOffset, header->modelCount, sizeof(uint32_t))
+        || !validArray(file, header->transformsOffset, header->modelCount, sizeof(LevelBinTransform))
+        || !validArray(file, header->colorsOffset, header->modelCount, sizeof(LevelBinColor))
+        || !validArray(file, header->lightsOffset, header->lightCount, sizeof(LevelBinLight))
+        || !validArray(file, header->instanceRangesOffset, header->modelCount, sizeof(LevelBinInstanceRange))
+        || !validArray(file, header->instanceTransformsOffset, header->instanceCount, sizeof(LevelBinTransform))
+        || !validArray(file, header->instanceColorsOffset, header->instanceCount, sizeof(LevelBinColor))
+        || !validArray(file, header->nodesOffset, header->modelCount, sizeof(LevelBinNode))) {
+        std::cerr << "Invalid or outdated level file, cook it again: " << filePath << std::endl;
+        return false;
+    }
+
+    const char* strings = file.getData() + header->stringsOffset;
+    const LevelBinMesh* meshes = (const LevelBinMesh*)(file.getData() + header->meshesOffset);
+    const uint32_t* modelMeshes = (const uint32_t*)(file.getData() + header->modelMeshesOffset);
+    const LevelBinTransform* transforms = (const LevelBinTransform*)(file.getData() + header->transformsOffset);
+    const LevelBinColor* colors = (const LevelBinColor*)(file.getData() + header->colorsOffset);
+    const LevelBinLight* lights = (const LevelBinLight*)(file.getData() + header->lightsOffset);
+    const LevelBinInstanceRange* instanceRanges = (const LevelBinInstanceRange*)(file.getData() + header->instanceRangesOffset);
+    const LevelBinTransform* instanceTransforms = (const LevelBinTransform*)(file.getData() + header->instanceTransformsOffset);
+    const LevelBinColor* instanceColors = (const LevelBinColor*)(file.getData() + header->instanceColorsOffset);
+    const LevelBinNode* nodes = (const LevelBinNode*)(file.getData() + header->nodesOffset);
+
+    // Expand each mesh entry once, models copy it and set their transform
+    std::vector<LevelModel> templates(header->meshCount);
+    for (uint32_t i = 0; i < header->meshCount; i++) {
+        const LevelBinMesh& mesh = meshes[i];
+        if (mesh.fileName >= header->stringsSize || mesh.vertexShader >= header->stringsSize
+            || mesh.fragmentShader >= header->stringsSize || mesh.lodCount > MaxMeshLods - 1) {
+            std::cerr << "Invalid mesh entry " << i << " in level file: " << filePath << std::endl;
+            return false;
+        }
+        LevelModel& model = templates[i];
+        model.fileName = strings + mesh.fileName;
+        model.vertexShader = strings + mesh.vertexShader;
+        model.fragmentShader = strings + mesh.fragmentShader;
+        model.hasRetention = true;
+        model.options.vertexFormat = (VertexFormat)mesh.vertexFormat;
+        model.options.retention = (MeshRetention)mesh.retention;
+        model.options.collisionRatio = mesh.collisionRatio;
+        model.options.lodRatios.assign(mesh.lodRatios, mesh.lodRatios + mesh.lodCount);
+    }
+
+    sink.onName(strings + header->name);
+    for (uint32_t i = 0; i < header->lightCount; i++) {
+        Light light;
+        light.position = glm::vec3(lights[i].position[0], lights[i].position[1], lights[i].position[2]);
+        light.color = glm::vec3(lights[i].color[0], lights[i].color[1], lights[i].color[2]);
+        light.intensity = lights[i].intensity;
+        sink.onLight(light);
+    }
+
+    for (uint32_t i = 0; i < header->modelCount; i++) {
+        const LevelBinInstanceRange& range = instanceRanges[i];
+        if (modelMeshes[i] >= header->meshCount || range.first > header->instanceCount
+            || range.count > header->instanceCount - range.first
+            || nodes[i].name >= header->stringsSize || nodes[i].parent >= header->stringsSize) {
+            std::cerr << "Invalid model " << i << " in level file: " << filePath << std::endl;
+            return false;
+        }
+        LevelModel model = templates[modelMeshes[i]];
+        model.name = strings + nodes[i].name;
+        model.parent = strings + nodes[i].parent;
+        model.x = transforms[i].x;
+        model.y = transforms[i].y;
+        model.z = transforms[i].z;
+        model.angle = transforms[i].angle;
+        model.color = glm::vec3(colors[i].r, colors[i].g, colors[i].b);
+        model.instances.resize(range.count);
+        for (uint32_t n = 0; n < range.count; n++) {
+            const LevelBinTransform& transform = instanceTransforms[range.first + n];
+            const LevelBinColor& color = instanceColors[range.first + n];
+            LevelInstance& instance = model.instances[n];
+            instance.x = transform.x;
+            instance.y = transform.y;
+            instance.z = transform.z;
+            instance.angle = transform.angle;
+            instance.color = glm::vec3(color.r, color.g, color.b);
+        }
+        sink.onModel(model);
+    }
+    return true;
+}
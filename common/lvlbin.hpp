@@ -0,0 +1,94 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "meshbin.hpp"
+#include "lvlparser.hpp"
+#include "light.hpp"
+
+#ifndef LVLBIN_HPP
+#define LVLBIN_HPP
+
+class MappedFile;
+
+// Cooked level written by the LevelCooker tool. The header is followed by
+// a string table and flat arrays, each 16 byte aligned, in the native byte
+// order so a mapping can be read in place. Models that are not loaded are
+// dropped and the level wide retention is already applied per mesh.
+static const uint32_t LevelBinVersion = 3;
+
+struct LevelBinHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t name;              // String table offset of the level name
+    uint32_t meshCount;
+    uint32_t modelCount;
+    uint32_t lightCount;
+    uint32_t instanceCount;
+    uint64_t stringsOffset;     // NUL terminated UTF-8 strings
+    uint64_t stringsSize;
+    uint64_t meshesOffset;      // LevelBinMesh[meshCount]
+    uint64_t modelMeshesOffset; // uint32_t[modelCount], index into the meshes
+    uint64_t transformsOffset;  // LevelBinTransform[modelCount]
+    uint64_t colorsOffset;      // LevelBinColor[modelCount]
+    uint64_t lightsOffset;      // LevelBinLight[lightCount]
+
+    // Instanced models own a range of the instance arrays, the others an
+    // empty one
+    uint64_t instanceRangesOffset;      // LevelBinInstanceRange[modelCount]
+    uint64_t instanceTransformsOffset;  // LevelBinTransform[instanceCount]
+    uint64_t instanceColorsOffset;      // LevelBinColor[instanceCount]
+
+    uint64_t nodesOffset;       // LevelBinNode[modelCount]
+};
+
+// A distinct mesh file, shader pair and load options. Models sharing all
+// of them share one entry.
+struct LevelBinMesh {
+    uint32_t fileName;          // String table offsets
+    uint32_t vertexShader;
+    uint32_t fragmentShader;
+    uint32_t vertexFormat;      // VertexFormat
+    uint32_t retention;         // MeshRetention
+    float collisionRatio;
+    uint32_t lodCount;          // Simplified levels, not counting LOD 0
+    float lodRatios[MaxMeshLods - 1];
+};
+
+// Scene graph names, string table offsets, empty when not set
+struct LevelBinNode {
+    uint32_t name;
+    uint32_t parent;
+};
+
+struct LevelBinTransform {
+    float x, y, z, angle;
+};
+
+struct LevelBinColor {
+    float r, g, b;
+};
+
+struct LevelBinInstanceRange {
+    uint32_t first;
+    uint32_t count;
+};
+
+struct LevelBinLight {
+    float position[3];
+    float color[3];
+    float intensity;
+};
+
+// Cooked levels are recognized by this extension
+bool isLevelBinPath(const std::string& filePath);
+
+// Writes the models and lights of a parsed level. Models with load false
+// are skipped, the others must already carry their final retention.
+bool writeLevelBin(const std::string& filePath, const std::string& name,
+    const std::vector<LevelModel>& models, const std::vector<Light>& lights);
+
+// Maps a cooked level and reports its records to the sink, in the same
+// order parseLevel() would. Nothing is parsed, the arrays are read in place.
+bool loadLevelBin(const std::string& filePath, LevelSink& sink);
+
+#endif
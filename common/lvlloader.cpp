@@ -1,25 +1,36 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <GL/glew.h>
-
-#include "../rapidjson/document.h"
-#include "../rapidjson/writer.h"
-#include "../rapidjson/stringbuffer.h"
+#include <cstddef>
 
 #include "vertex.hpp"
 #include "normal.hpp"
 #include "face.hpp"
+#include "mesh.hpp"
+#include "meshregistry.hpp"
 #include "object.hpp"
+#include "instancebuffer.hpp"
 #include "light.hpp"
-#include "shader.hpp"
+#include "programregistry.hpp"
+#include "shaderprogram.hpp"
+#include "shadervariants.hpp"
+#include "memorystats.hpp"
+#include "lvlparser.hpp"
+#include "lvlbin.hpp"
 #include "lvlloader.hpp"
 
-LvlLoader::LvlLoader(const std::string& filePath) {
-    loadLevel(filePath);
+const size_t LvlLoader::NoObject;
+
+LvlLoader::LvlLoader(const std::string& filePath, bool asynchronous)
+    : _residentBeforeUpload(0), _residentAfterUpload(0), _loadedModels(0) {
+    loadLevel(filePath, asynchronous);
 }
 
 const std::string& LvlLoader::getName() const {
@@ -34,156 +45,305 @@ std::vector<Light>& LvlLoader::getLights() {
     return _lights;
 }
 
-GLuint LvlLoader::createVertexBuffer(const std::vector<Vertex>& vertices) {
-    GLuint vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-    return vbo;
+size_t LvlLoader::getIndexBytes() const {
+    return _meshes.getIndexBytes();
+}
+
+size_t LvlLoader::getIndexBytesSaved() const {
+    return _meshes.getIndexBytesSaved();
+}
+
+const MeshRegistry& LvlLoader::getMeshRegistry() const {
+    return _meshes;
+}
+
+const ProgramRegistry& LvlLoader::getProgramRegistry() const {
+    return _programs;
+}
+
+size_t LvlLoader::getResidentBeforeUpload() const {
+    return _residentBeforeUpload;
+}
+
+size_t LvlLoader::getResidentAfterUpload() const {
+    return _residentAfterUpload;
+}
+
+std::vector<RenderItem>& LvlLoader::getRenderItems() {
+    return _renderItems;
+}
+
+const SceneGraph& LvlLoader::getSceneGraph() const {
+    return _scene;
+}
+
+void LvlLoader::markObjectChanged(size_t index) {
+    _changedObjects.push_back(index);
+}
+
+void LvlLoader::updateRenderItems() {
+    for (size_t index : _changedObjects) {
+        const Object& object = _objects[index];
+        _scene.setLocalTransform(object.node, object.locationX, object.locationY, object.locationZ, object.angle);
+        _renderItems[index].color = object.color;
+    }
+    _changedObjects.clear();
+
+    // Only the moved nodes and their children are recomputed
+    _scene.update();
+    for (size_t node : _scene.getUpdatedNodes()) {
+        size_t index = _nodeObjects[node];
+        if (index != NoObject) {
+            _renderItems[index].model = _scene.getWorldMatrix(node);
+            _renderItems[index].normalMatrix = _scene.getNormalMatrix(node);
+        }
+    }
 }
 
-GLuint LvlLoader::createElementBuffer(const std::vector<Face>& faces) {
-    GLuint ebo;
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, faces.size() * sizeof(Face), faces.data(), GL_STATIC_DRAW);
-    return ebo;
+void LvlLoader::buildSceneGraph() {
+    // Transforms go into the graph's SoA arrays, the update() below
+    // composes every local matrix in one batched pass
+    _scene.reserve(_models.size());
+
+    // Names are looked up among the loaded models only
+    std::map<std::string, size_t> nodes;
+    for (size_t i = 0; i < _models.size(); i++) {
+        const LevelModel& model = _models[i];
+        _scene.addNode(model.x, model.y, model.z, model.angle);
+        if (!model.name.empty() && !nodes.insert(std::make_pair(model.name, i)).second) {
+            std::cerr << "Duplicate model name: " << model.name << ", children attach to the first" << std::endl;
+        }
+    }
+    for (size_t i = 0; i < _models.size(); i++) {
+        const std::string& parent = _models[i].parent;
+        if (parent.empty()) {
+            continue;
+        }
+        std::map<std::string, size_t>::iterator it = nodes.find(parent);
+        if (it == nodes.end()) {
+            std::cerr << "Unknown parent " << parent << " for model: " << _models[i].fileName << std::endl;
+            continue;
+        }
+        _scene.setParent(i, it->second);
+    }
+    _nodeObjects.assign(_models.size(), NoObject);
+    _scene.update();
 }
 
-void LvlLoader::loadLevel(const std::string& filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        std::cerr << "Error opening file: " << filePath << std::endl;
+void LvlLoader::loadLevel(const std::string& filePath, bool asynchronous) {
+    // Cooked levels are read in place, JSON is streamed
+    LevelData level;
+    bool parsed = isLevelBinPath(filePath) ? loadLevelBin(filePath, level) : parseLevel(filePath, level);
+    if (!parsed) {
+        return;
+    }
+    level.applyRetention();
+
+    _name = level.name;
+    _lights.swap(level.lights);
+    for (const LevelModel& model : level.models) {
+        if (!model.load) {
+            std::cerr << "Skipped Model: " << model.fileName << " x: " << model.x << " y: " << model.y << std::endl;
+            continue;
+        }
+        _models.push_back(model);
+    }
+    buildSceneGraph();
+    submitPrograms();
+
+    _residentBeforeUpload = getResidentBytes();
+    if (!asynchronous) {
+        // Repeated files share one parsed and uploaded mesh
+        for (size_t i = 0; i < _models.size(); i++) {
+            addObject(i, _meshes.acquire(_models[i].fileName, _models[i].options));
+            _loadedModels++;
+        }
+        _programs.finish();
+        finishLoading();
         return;
     }
 
-    // Read the entire file into a string 
-    std::string json((std::istreambuf_iterator<char>(file)), 
-                std::istreambuf_iterator<char>()); 
-  
-    // Create a Document object  
-      // to hold the JSON data 
-    rapidjson::Document doc; 
-  
-    // Parse the JSON data 
-    doc.Parse(json.c_str()); 
-  
-    // Check for parse errors 
-    if (doc.HasParseError()) { 
-        std::cerr << "Error parsing JSON: "
-             << doc.GetParseError() << std::endl; 
+    _loaderThreads.reset(new ThreadPool());
+    std::cerr << "Loading " << _models.size() << " models on " << _loaderThreads->getThreadCount() << " threads" << std::endl;
+    for (size_t i = 0; i < _models.size(); i++) {
+        startLoading(_models[i], i);
+    }
+    if (_models.empty()) {
+        finishLoading();
+    }
+}
+
+// Every program the level needs is submitted before any mesh loads, so the
+// driver compiles them while the meshes are parsed. Each model gets the
+// tightest variant its shaders declare, objects needing the same one share
+// a program.
+void LvlLoader::submitPrograms() {
+    ShaderVariants variants;
+    VariantFeatures features;
+    features.lightCount = std::min((int)_lights.size(), MaxLights);
+    _modelPrograms.resize(_models.size());
+    for (size_t i = 0; i < _models.size(); i++) {
+        const LevelModel& model = _models[i];
+        features.quantized = model.options.vertexFormat == VertexFormatQuantized;
+        features.instanced = !model.instances.empty();
+        std::vector<std::string> defines = variants.select(model.vertexShader, model.fragmentShader, features);
+        _modelPrograms[i] = _programs.acquire(model.vertexShader, model.fragmentShader, defines);
+    }
+}
+
+void LvlLoader::startLoading(const LevelModel& model, size_t index) {
+    // Repeated files wait for the one parse already in flight
+    std::string pathKey = MeshRegistry::pathKey(model.fileName, model.options);
+    std::vector<size_t>& waiting = _waitingModels[pathKey];
+    waiting.push_back(index);
+    if (waiting.size() > 1) {
         return;
     }
 
-    rapidjson::Value& jName = doc["Name"];
-    rapidjson::Value& jModels = doc["Models"];
-    rapidjson::Value& lights = doc["Lights"];
-
-    for (rapidjson::SizeType i = 0; i < lights.Size(); i++) {
-        rapidjson::Value& light = lights[i];
-        glm::vec3 position = glm::vec3(
-            light["Position"][0].GetFloat(),
-            light["Position"][1].GetFloat(),
-            light["Position"][2].GetFloat()
-        );
-        glm::vec3 color = glm::vec3(
-            light["Color"][0].GetFloat(),
-            light["Color"][1].GetFloat(),
-            light["Color"][2].GetFloat()
-        );
-        float intensity = light["Intensity"].GetFloat();
-        Light theLight = Light();
-        theLight.position = position;
-        theLight.color = color;
-        theLight.intensity = intensity;
-        _lights.push_back(theLight);
+    std::string fileName = model.fileName;
+    ObjLoadOptions options = model.options;
+    _loaderThreads->submit([this, pathKey, fileName, options]() {
+        LoadedMesh loaded;
+        loaded.pathKey = pathKey;
+        loaded.contentKey = MeshRegistry::contentKey(fileName, options);
+        loaded.objLoader.reset(new ObjLoader(fileName, options));
+
+        std::lock_guard<std::mutex> lock(_loadedMeshesMutex);
+        _loadedMeshes.push_back(std::move(loaded));
+    });
+}
+
+void LvlLoader::update(double budgetSeconds) {
+    // Programs can finish after the last mesh
+    _programs.update();
+    if (!isLoading()) {
+        return;
     }
-    
-    _name = jName.GetString();
-    rapidjson::Value& models = jModels.GetArray();
-
-    for (rapidjson::SizeType i = 0; i < models.Size(); i++) {
-        rapidjson::Value& model = models[i];
-        std::string fileName = model["FileName"].GetString();
-        std::string fragmentShader = model["FragmentShader"].GetString();
-        std::string vertexShader = model["VertexShader"].GetString();
-        float x = model["LocationX"].GetFloat();
-        float y = model["LocationY"].GetFloat();
-        float z = model["LocationZ"].GetFloat();
-        float angle = model["Angle"].GetFloat();
-        bool load = model["LoadObject"].GetBool();
-        glm::vec3 color = glm::vec3(
-            model["Color"][0].GetFloat(),
-            model["Color"][1].GetFloat(),
-            model["Color"][2].GetFloat()
-        );
-
-        if (!load) {
-            std::cerr << "Skipped Model: " << fileName << " x: " << x << " y: " << y << std::endl;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do {
+        // Create one object per step, each compiles its shaders
+        if (!_readyModels.empty()) {
+            size_t index = _readyModels.front().first;
+            std::shared_ptr<Mesh> mesh = _readyModels.front().second;
+            _readyModels.pop_front();
+            addObject(index, mesh);
+            _loadedModels++;
             continue;
         }
 
-        std::cerr << "Loaded Model: " << fileName << " x: " << x << " y: " << y << std::endl;
-
-        // Create Vertex Array Object (VAO)
-        GLuint vao;
-        glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
-
-        // new Object
-        Object object(fileName);
-        object.vao = vao;
-        object.locationX = x;
-        object.locationY = y;
-        object.locationZ = z;
-        object.angle = angle;
-
-        // Create Vertex Buffer Object (VBO)
-        GLuint vbo = createVertexBuffer(object.objLoader.getVertices());
-        object.vbo = vbo;
-
-        // Create Element Buffer Object (EBO)
-        GLuint ebo = createElementBuffer(object.objLoader.getFaces());
-        object.ebo = ebo;
-
-        // Specify the layout of the vertex data
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        // Specify the layout of the normal data
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        // Unbind VAO, VBO, and EBO
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-
-        // load the shaders
-        object.fragmentShader = fragmentShader;
-        object.vertexShader = vertexShader;
-
-        // Create and compile our GLSL program from the shaders
-	    object.programID = LoadShaders(vertexShader.c_str(), fragmentShader.c_str());
-        if (object.programID == 0) {
-            std::cerr << "Error loading shaders for model: " << fileName << std::endl;
-            continue;
+        // Otherwise upload one parsed mesh
+        LoadedMesh loaded;
+        {
+            std::lock_guard<std::mutex> lock(_loadedMeshesMutex);
+            if (_loadedMeshes.empty()) {
+                break;
+            }
+            loaded = std::move(_loadedMeshes.front());
+            _loadedMeshes.pop_front();
         }
 
-        std::cerr << "Loaded shader programId: " << object.programID 
-                  << " for model: " << fileName << std::endl;
+        std::vector<size_t> waiting;
+        waiting.swap(_waitingModels[loaded.pathKey]);
+        _waitingModels.erase(loaded.pathKey);
+        const LevelModel& model = _models[waiting[0]];
+        std::shared_ptr<Mesh> mesh = _meshes.acquireLoaded(model.fileName, model.options,
+            loaded.contentKey, std::move(*loaded.objLoader));
+        for (size_t i = 0; i < waiting.size(); i++) {
+            // The first model is a miss or a content hit, the rest share it
+            if (i > 0) {
+                _meshes.acquire(_models[waiting[i]].fileName, _models[waiting[i]].options);
+            }
+            _readyModels.push_back(std::make_pair(waiting[i], mesh));
+        }
+    } while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < budgetSeconds);
+
+    if (!isLoading()) {
+        finishLoading();
+    }
+}
+
+bool LvlLoader::isLoading() const {
+    return _loadedModels < _models.size();
+}
+
+size_t LvlLoader::getModelCount() const {
+    return _models.size();
+}
+
+size_t LvlLoader::getLoadedModelCount() const {
+    return _loadedModels;
+}
+
+void LvlLoader::addObject(size_t index, const std::shared_ptr<Mesh>& mesh) {
+    const LevelModel& model = _models[index];
+    std::cerr << "Loaded Model: " << model.fileName << " x: " << model.x << " y: " << model.y << std::endl;
+
+    // new Object
+    Object object(mesh);
+    object.locationX = model.x;
+    object.locationY = model.y;
+    object.locationZ = model.z;
+    object.angle = model.angle;
+    object.node = index;
 
-        // Set the color
-        object.color = color;
+    // load the shaders
+    object.fragmentShader = model.fragmentShader;
+    object.vertexShader = model.vertexShader;
 
-        // Store the VAO in the objects vector
-        _objects.push_back(object);
+    // Submitted by loadLevel, it may still be compiling
+    object.program = _modelPrograms[index];
+    if (!object.program) {
+        std::cerr << "Error loading shaders for model: " << model.fileName << std::endl;
+        return;
     }
+
+    std::cerr << "Using shader programId: " << object.program->getID()
+              << " for model: " << model.fileName << std::endl;
+
+    // Set the color
+    object.color = model.color;
+
+    // Instance transforms and colors go into one buffer, drawn in one call
+    if (!model.instances.empty()) {
+        object.instances = std::make_shared<InstanceBuffer>(*mesh, model.instances);
+        std::cerr << "Uploaded " << model.instances.size() << " instances of " << model.fileName << ": "
+                  << object.instances->getBufferBytes() / 1024 << " KB" << std::endl;
+    }
+
+    // Store the object, it shares the mesh's VAO. Its node's world matrix
+    // is already current, objects loading later follow edits to parents.
+    _nodeObjects[index] = _objects.size();
+    _objects.push_back(object);
+    _renderItems.push_back(object.createRenderItem());
+    _renderItems.back().model = _scene.getWorldMatrix(index);
+    _renderItems.back().normalMatrix = _scene.getNormalMatrix(index);
+}
+
+void LvlLoader::finishLoading() {
+    // The loader threads have nothing left to do
+    _loaderThreads.reset();
+
+    std::cerr << "Meshes: " << _meshes.getMeshCount() << " unique, " << _meshes.getHits() << " cache hits, "
+              << _meshes.getMisses() << " misses" << std::endl;
+    std::cerr << "Programs: " << _programs.getBinaryLoadCount() << " loaded from binaries in "
+              << _programs.getBinaryLoadSeconds() * 1000.0 << " ms, " << _programs.getHits() << " shared, "
+              << _programs.getPendingCount() << " still compiling" << std::endl;
+    _modelPrograms.clear();
+
+    _residentAfterUpload = getResidentBytes();
+    std::cerr << "Resident memory: " << _residentBeforeUpload / (1024 * 1024) << " MB before meshes, "
+              << _residentAfterUpload / (1024 * 1024) << " MB after upload" << std::endl;
 }
 
 void LvlLoader::destroyObjects() {
-    for (Object& object : _objects) {
-        glDeleteVertexArrays(1, &object.vao);
-        glDeleteBuffers(1, &object.vbo);
-        glDeleteBuffers(1, &object.ebo);
-    }
+    // Stop loading, then each mesh deletes its buffers once, with its last object
+    _loaderThreads.reset();
+    _loadedMeshes.clear();
+    _readyModels.clear();
+    _objects.clear();
+    _renderItems.clear();
+    _modelPrograms.clear();
+    _changedObjects.clear();
+    _nodeObjects.assign(_nodeObjects.size(), NoObject);
 }
@@ -1,23 +1,108 @@
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "meshregistry.hpp"
+#include "programregistry.hpp"
+#include "lvlparser.hpp"
+#include "renderitem.hpp"
+#include "scenegraph.hpp"
+#include "threadpool.hpp"
+
 #ifndef LVLLOADER_HPP
 #define LVLLOADER_HPP
 
 class LvlLoader {
 public:
-    LvlLoader(const std::string& filePath);
+    // When asynchronous, meshes are parsed on loader threads and objects
+    // appear as update() uploads them. Otherwise everything is loaded
+    // before the constructor returns.
+    LvlLoader(const std::string& filePath, bool asynchronous = false);
     const std::string& getName() const;
     const std::vector<Object>& getObjects() const;          // const version
     std::vector<Object>& getObjects();                      // non-const version (add this)
     const std::vector<Light>& getLights() const;
     std::vector<Light>& getLights();                        // non-const version (add this)
     void destroyObjects();
+
+    // Uploads parsed meshes and creates their objects on the GL thread until
+    // budgetSeconds have passed, at least one step per call, and picks up
+    // linked programs. Call once per frame.
+    void update(double budgetSeconds);
+    bool isLoading() const;
+    size_t getModelCount() const;
+    size_t getLoadedModelCount() const;
+
+    // One RenderItem per object, in the same order as getObjects()
+    std::vector<RenderItem>& getRenderItems();
+    // Call after editing an object's transform or color, e.g. from a
+    // slider or an animation
+    void markObjectChanged(size_t index);
+    // Pushes changed transforms through the scene graph and copies the
+    // recomputed world matrices and changed colors into the render items
+    void updateRenderItems();
+
+    // Parent/child transforms, one node per level model
+    const SceneGraph& getSceneGraph() const;
+
+    // Element buffer bytes uploaded, and bytes saved by 16-bit indices
+    size_t getIndexBytes() const;
+    size_t getIndexBytesSaved() const;
+
+    // Process resident memory before the meshes loaded and once they were
+    // uploaded and their CPU data released per MeshRetention
+    size_t getResidentBeforeUpload() const;
+    size_t getResidentAfterUpload() const;
+
+    // Shared meshes and their cache hits and misses
+    const MeshRegistry& getMeshRegistry() const;
+    // Shared shader programs, with their compile count and time
+    const ProgramRegistry& getProgramRegistry() const;
 private:
+    static const size_t NoObject = (size_t)-1;
+
     std::vector<Object> _objects;
     std::vector<Light> _lights;
+    std::vector<RenderItem> _renderItems;
     std::string _name;
+    MeshRegistry _meshes;
+    ProgramRegistry _programs;
+    size_t _residentBeforeUpload;
+    size_t _residentAfterUpload;
+
+    // Mesh parsed on a loader thread, waiting for upload on the GL thread
+    struct LoadedMesh {
+        std::string pathKey;
+        std::string contentKey;
+        std::unique_ptr<ObjLoader> objLoader;
+    };
+
+    std::vector<LevelModel> _models;
+    size_t _loadedModels;
+    // Program of each model, held until its object exists
+    std::vector<std::shared_ptr<ShaderProgram>> _modelPrograms;
+    // Node i belongs to _models[i], objects point back at their node
+    SceneGraph _scene;
+    std::vector<size_t> _nodeObjects;
+    std::vector<size_t> _changedObjects;
+    // Models waiting for each mesh in flight, by MeshRegistry::pathKey
+    std::map<std::string, std::vector<size_t>> _waitingModels;
+    // Filled by loader threads
+    std::deque<LoadedMesh> _loadedMeshes;
+    std::mutex _loadedMeshesMutex;
+    // Uploaded meshes whose objects are not created yet
+    std::deque<std::pair<size_t, std::shared_ptr<Mesh>>> _readyModels;
+    // Declared last so the workers stop before the queues go away
+    std::unique_ptr<ThreadPool> _loaderThreads;
 
-    GLuint createVertexBuffer(const std::vector<Vertex>& vertices);
-    GLuint createElementBuffer(const std::vector<Face>& faces);
-    void loadLevel(const std::string& filePath);
+    void loadLevel(const std::string& filePath, bool asynchronous);
+    void startLoading(const LevelModel& model, size_t index);
+    void buildSceneGraph();
+    void submitPrograms();
+    void addObject(size_t index, const std::shared_ptr<Mesh>& mesh);
+    void finishLoading();
 };
 
 #endif
\ No newline at end of file
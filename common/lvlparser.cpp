@@ -0,0 +1,370 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../rapidjson/document.h"
+#include "../rapidjson/reader.h"
+#include "../rapidjson/filereadstream.h"
+#include "../rapidjson/error/en.h"
+
+#include "objloader.hpp"
+#include "light.hpp"
+
+#include "lvlparser.hpp"
+
+LevelData::LevelData() : retention(MeshRetentionAll) {
+}
+
+void LevelData::onName(const std::string& levelName) {
+    name = levelName;
+}
+
+void LevelData::onMeshRetention(MeshRetention levelRetention) {
+    retention = levelRetention;
+}
+
+void LevelData::onLight(const Light& light) {
+    lights.push_back(light);
+}
+
+void LevelData::onModel(const LevelModel& model) {
+    models.push_back(model);
+}
+
+void LevelData::applyRetention() {
+    for (LevelModel& model : models) {
+        if (!model.hasRetention) {
+            model.options.retention = retention;
+            model.hasRetention = true;
+        }
+    }
+}
+
+MeshRetention parseMeshRetention(const std::string& name) {
+    if (name == "Bounds") {
+        return MeshRetentionBounds;
+    }
+    if (name == "Collision") {
+        return MeshRetentionCollision;
+    }
+    if (name != "All") {
+        std::cerr << "Unknown MeshRetention: " << name << std::endl;
+    }
+    return MeshRetentionAll;
+}
+
+// SAX state machine for the level layout. Depth 1 is the level object,
+// 2 the Lights and Models arrays, 3 one record and 4 an array inside a
+// record such as Color or LODs. A model's Instances array holds one
+// object per instance at depth 5, with arrays such as Location at depth 6.
+// Unknown keys are skipped.
+class LevelHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, LevelHandler> {
+public:
+    LevelHandler(LevelSink& sink) : _sink(sink), _depth(0), _section(SectionNone), _element(0) {}
+
+    bool StartObject() {
+        _depth++;
+        if (_depth == 5 && _section == SectionModels && _recordKey == "Instances") {
+            _model.instances.push_back(LevelInstance());
+        }
+        if (_depth == 3) {
+            _model = LevelModel();
+            _light = Light();
+            _light.position = glm::vec3(0.0f);
+            _light.color = glm::vec3(1.0f);
+            _light.intensity = 1.0f;
+        }
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        if (_depth == 3 && _section == SectionLights) {
+            _sink.onLight(_light);
+        } else if (_depth == 3 && _section == SectionModels) {
+            _sink.onModel(_model);
+        }
+        _depth--;
+        return true;
+    }
+
+    bool StartArray() {
+        _depth++;
+        if (_depth == 2) {
+            _section = _levelKey == "Lights" ? SectionLights : _levelKey == "Models" ? SectionModels : SectionNone;
+        }
+        _element = 0;
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        if (_depth == 2) {
+            _section = SectionNone;
+        }
+        _depth--;
+        return true;
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool) {
+        if (_depth == 1) {
+            _levelKey.assign(str, length);
+        } else if (_depth == 3) {
+            _recordKey.assign(str, length);
+        } else if (_depth == 5) {
+            _instanceKey.assign(str, length);
+        }
+        return true;
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        std::string value(str, length);
+        if (_depth == 1) {
+            if (_levelKey == "Name") {
+                _sink.onName(value);
+            } else if (_levelKey == "MeshRetention") {
+                _sink.onMeshRetention(parseMeshRetention(value));
+            }
+        } else if (_depth == 3 && _section == SectionModels) {
+            if (_recordKey == "Name") {
+                _model.name = value;
+            } else if (_recordKey == "Parent") {
+                _model.parent = value;
+            } else if (_recordKey == "FileName") {
+                _model.fileName = value;
+            } else if (_recordKey == "FragmentShader") {
+                _model.fragmentShader = value;
+            } else if (_recordKey == "VertexShader") {
+                _model.vertexShader = value;
+            } else if (_recordKey == "VertexFormat") {
+                _model.options.vertexFormat = value == "Quantized" ? VertexFormatQuantized : VertexFormatFloat;
+            } else if (_recordKey == "MeshRetention") {
+                _model.options.retention = parseMeshRetention(value);
+                _model.hasRetention = true;
+            }
+        }
+        return true;
+    }
+
+    bool Bool(bool value) {
+        if (_depth == 3 && _section == SectionModels && _recordKey == "LoadObject") {
+            _model.load = value;
+        }
+        return true;
+    }
+
+    bool Int(int value) { return number(value); }
+    bool Uint(unsigned value) { return number(value); }
+    bool Int64(int64_t value) { return number((double)value); }
+    bool Uint64(uint64_t value) { return number((double)value); }
+    bool Double(double value) { return number(value); }
+
+private:
+    enum Section {
+        SectionNone,
+        SectionLights,
+        SectionModels
+    };
+
+    LevelSink& _sink;
+    int _depth;
+    Section _section;
+    std::string _levelKey;
+    std::string _recordKey;
+    std::string _instanceKey;
+    size_t _element;
+    LevelModel _model;
+    Light _light;
+
+    bool number(double number) {
+        float value = (float)number;
+        if (_depth == 3 && _section == SectionModels) {
+            if (_recordKey == "LocationX") {
+                _model.x = value;
+            } else if (_recordKey == "LocationY") {
+                _model.y = value;
+            } else if (_recordKey == "LocationZ") {
+                _model.z = value;
+            } else if (_recordKey == "Angle") {
+                _model.angle = value;
+            } else if (_recordKey == "CollisionRatio") {
+                _model.options.collisionRatio = value;
+            }
+        } else if (_depth == 3 && _section == SectionLights) {
+            if (_recordKey == "Intensity") {
+                _light.intensity = value;
+            }
+        } else if (_depth == 4 && _section == SectionModels) {
+            if (_recordKey == "Color" && _element < 3) {
+                _model.color[(int)_element] = value;
+            } else if (_recordKey == "LODs") {
+                _model.options.lodRatios.push_back(value);
+            }
+            _element++;
+        } else if (_depth == 5 && _section == SectionModels && _recordKey == "Instances" && !_model.instances.empty()) {
+            if (_instanceKey == "Angle") {
+                _model.instances.back().angle = value;
+            }
+        } else if (_depth == 6 && _section == SectionModels && _recordKey == "Instances" && !_model.instances.empty()) {
+            LevelInstance& instance = _model.instances.back();
+            if (_instanceKey == "Location" && _element < 3) {
+                float* location[3] = { &instance.x, &instance.y, &instance.z };
+                *location[_element] = value;
+            } else if (_instanceKey == "Color" && _element < 3) {
+                instance.color[(int)_element] = value;
+            }
+            _element++;
+        } else if (_depth == 4 && _section == SectionLights) {
+            if (_recordKey == "Position" && _element < 3) {
+                _light.position[(int)_element] = value;
+            } else if (_recordKey == "Color" && _element < 3) {
+                _light.color[(int)_element] = value;
+            }
+            _element++;
+        }
+        return true;
+    }
+};
+
+bool parseLevel(const std::string& filePath, LevelSink& sink) {
+    FILE* file = fopen(filePath.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return false;
+    }
+
+    char buffer[65536];
+    rapidjson::FileReadStream stream(file, buffer, sizeof(buffer));
+    LevelHandler handler(sink);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse(stream, handler);
+    fclose(file);
+
+    if (!result) {
+        std::cerr << "Error parsing JSON: " << filePath << ": " << rapidjson::GetParseError_En(result.Code())
+                  << " at offset " << result.Offset() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool parseLevelDom(const std::string& filePath, LevelSink& sink) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return false;
+    }
+
+    // Read the entire file into a string
+    std::string json((std::istreambuf_iterator<char>(file)),
+                std::istreambuf_iterator<char>());
+
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    if (doc.HasParseError()) {
+        std::cerr << "Error parsing JSON: "
+             << doc.GetParseError() << std::endl;
+        return false;
+    }
+
+    sink.onName(doc["Name"].GetString());
+    if (doc.HasMember("MeshRetention")) {
+        sink.onMeshRetention(parseMeshRetention(doc["MeshRetention"].GetString()));
+    }
+
+    rapidjson::Value& lights = doc["Lights"];
+    for (rapidjson::SizeType i = 0; i < lights.Size(); i++) {
+        rapidjson::Value& light = lights[i];
+        Light theLight = Light();
+        theLight.position = glm::vec3(
+            light["Position"][0].GetFloat(),
+            light["Position"][1].GetFloat(),
+            light["Position"][2].GetFloat()
+        );
+        theLight.color = glm::vec3(
+            light["Color"][0].GetFloat(),
+            light["Color"][1].GetFloat(),
+            light["Color"][2].GetFloat()
+        );
+        theLight.intensity = light["Intensity"].GetFloat();
+        sink.onLight(theLight);
+    }
+
+    rapidjson::Value& models = doc["Models"];
+    for (rapidjson::SizeType i = 0; i < models.Size(); i++) {
+        rapidjson::Value& model = models[i];
+        LevelModel levelModel;
+        levelModel.fileName = model["FileName"].GetString();
+        levelModel.fragmentShader = model["FragmentShader"].GetString();
+        levelModel.vertexShader = model["VertexShader"].GetString();
+        levelModel.x = model["LocationX"].GetFloat();
+        levelModel.y = model["LocationY"].GetFloat();
+        levelModel.z = model["LocationZ"].GetFloat();
+        levelModel.angle = model["Angle"].GetFloat();
+        levelModel.load = model["LoadObject"].GetBool();
+        levelModel.color = glm::vec3(
+            model["Color"][0].GetFloat(),
+            model["Color"][1].GetFloat(),
+            model["Color"][2].GetFloat()
+        );
+
+        // Optional, the transform is relative to the model with the parent's name
+        if (model.HasMember("Name")) {
+            levelModel.name = model["Name"].GetString();
+        }
+        if (model.HasMember("Parent")) {
+            levelModel.parent = model["Parent"].GetString();
+        }
+
+        // Optional, "Float" (default) or "Quantized"
+        ObjLoadOptions& options = levelModel.options;
+        if (model.HasMember("VertexFormat") && std::string(model["VertexFormat"].GetString()) == "Quantized") {
+            options.vertexFormat = VertexFormatQuantized;
+        }
+
+        // Optional triangle ratios of the simplified LODs, e.g. [0.5, 0.25, 0.1]
+        if (model.HasMember("LODs")) {
+            const rapidjson::Value& lods = model["LODs"];
+            for (rapidjson::SizeType l = 0; l < lods.Size(); l++) {
+                options.lodRatios.push_back(lods[l].GetFloat());
+            }
+        }
+
+        // CPU data kept after upload, and the collision copy's triangle ratio
+        if (model.HasMember("MeshRetention")) {
+            options.retention = parseMeshRetention(model["MeshRetention"].GetString());
+            levelModel.hasRetention = true;
+        }
+        if (model.HasMember("CollisionRatio")) {
+            options.collisionRatio = model["CollisionRatio"].GetFloat();
+        }
+
+        // Optional, one entry per instance, every key optional
+        if (model.HasMember("Instances")) {
+            const rapidjson::Value& instances = model["Instances"];
+            for (rapidjson::SizeType n = 0; n < instances.Size(); n++) {
+                const rapidjson::Value& instance = instances[n];
+                LevelInstance levelInstance;
+                if (instance.HasMember("Location")) {
+                    levelInstance.x = instance["Location"][0].GetFloat();
+                    levelInstance.y = instance["Location"][1].GetFloat();
+                    levelInstance.z = instance["Location"][2].GetFloat();
+                }
+                if (instance.HasMember("Angle")) {
+                    levelInstance.angle = instance["Angle"].GetFloat();
+                }
+                if (instance.HasMember("Color")) {
+                    levelInstance.color = glm::vec3(
+                        instance["Color"][0].GetFloat(),
+                        instance["Color"][1].GetFloat(),
+                        instance["Color"][2].GetFloat()
+                    );
+                }
+                levelModel.instances.push_back(levelInstance);
+            }
+        }
+        sink.onModel(levelModel);
+    }
+    return true;
+}
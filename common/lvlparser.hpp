@@ -0,0 +1,87 @@
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "objloader.hpp"
+#include "light.hpp"
+
+#ifndef LVLPARSER_HPP
+#define LVLPARSER_HPP
+
+// One placement of an instanced model, relative to the model's own
+// location and angle. The color multiplies the model's color.
+struct LevelInstance {
+    float x;
+    float y;
+    float z;
+    float angle;
+    glm::vec3 color;
+
+    LevelInstance() : x(0.0f), y(0.0f), z(0.0f), angle(0.0f), color(1.0f) {}
+};
+
+// One model entry of the level file, kept until its object is created
+struct LevelModel {
+    std::string name;       // Optional "Name", referenced by children
+    std::string parent;     // Optional "Parent", the transform is relative to it
+    std::string fileName;
+    std::string fragmentShader;
+    std::string vertexShader;
+    float x;
+    float y;
+    float z;
+    float angle;
+    glm::vec3 color;
+    bool load;              // "LoadObject"
+    bool hasRetention;      // options.retention came from the model entry
+    ObjLoadOptions options;
+    // "Instances", drawn with one instanced draw call when not empty
+    std::vector<LevelInstance> instances;
+
+    LevelModel() : x(0.0f), y(0.0f), z(0.0f), angle(0.0f), color(1.0f), load(true), hasRetention(false) {}
+};
+
+// Receives the records of a level file in file order. The level wide
+// retention can come after the models, so it is reported on its own and
+// models without their own setting should take it once parsing ends.
+class LevelSink {
+public:
+    virtual ~LevelSink() {}
+    virtual void onName(const std::string& name) = 0;
+    virtual void onMeshRetention(MeshRetention retention) = 0;
+    virtual void onLight(const Light& light) = 0;
+    virtual void onModel(const LevelModel& model) = 0;
+};
+
+// Sink that keeps every record, skipped models included
+class LevelData : public LevelSink {
+public:
+    LevelData();
+
+    std::string name;
+    MeshRetention retention;    // Level wide default
+    std::vector<Light> lights;
+    std::vector<LevelModel> models;
+
+    void onName(const std::string& levelName);
+    void onMeshRetention(MeshRetention levelRetention);
+    void onLight(const Light& light);
+    void onModel(const LevelModel& model);
+
+    // Gives models without their own MeshRetention the level's, call once
+    // the whole file is read
+    void applyRetention();
+};
+
+// "All", "Bounds" or "Collision", anything else keeps everything
+MeshRetention parseMeshRetention(const std::string& name);
+
+// Streams the file through a rapidjson SAX reader with a fixed size read
+// buffer, so memory stays flat however many models the level holds.
+// Records are handed to the sink as soon as their closing brace is read.
+bool parseLevel(const std::string& filePath, LevelSink& sink);
+
+// Reads the whole file and builds a rapidjson DOM first, kept to compare
+// against parseLevel() in the benchmarks
+bool parseLevelDom(const std::string& filePath, LevelSink& sink);
+
+#endif
@@ -0,0 +1,84 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mappedfile.hpp"
+
+MappedFile::MappedFile() : _data(nullptr), _size(0), _open(false) {
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filePath) {
+    close();
+
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // mmap rejects zero-length mappings, an empty file is still a valid open
+    _size = (size_t)st.st_size;
+    if (_size > 0) {
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            std::cerr << "Error mapping file: " << filePath << std::endl;
+            ::close(fd);
+            _size = 0;
+            return false;
+        }
+        _data = data;
+
+        // We read front to back, let the kernel read ahead aggressively
+        madvise(_data, _size, MADV_SEQUENTIAL);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    _open = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data) {
+        munmap(_data, _size);
+    }
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+}
+
+bool MappedFile::isOpen() const {
+    return _open;
+}
+
+const char* MappedFile::getData() const {
+    return (const char*)_data;
+}
+
+size_t MappedFile::getSize() const {
+    return _size;
+}
+
+std::string canonicalPath(const std::string& filePath) {
+    char* resolved = realpath(filePath.c_str(), nullptr);
+    if (!resolved) {
+        return filePath;
+    }
+    std::string path(resolved);
+    free(resolved);
+    return path;
+}
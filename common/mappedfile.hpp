@@ -0,0 +1,34 @@
+#include <string>
+#include <cstddef>
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+// Read-only memory mapping of a whole file. The mapping is released when the
+// object is destroyed, so it is neither copyable nor assignable.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& filePath);
+    void close();
+
+    bool isOpen() const;
+    const char* getData() const;
+    size_t getSize() const;
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void* _data;
+    size_t _size;
+    bool _open;
+};
+
+// Resolves ./, ../ and symlinks so every spelling of a path shares a
+// cache key. Paths that do not resolve are returned unchanged.
+std::string canonicalPath(const std::string& filePath);
+
+#endif
@@ -0,0 +1,13 @@
+#include <cstddef>
+
+#ifndef MEMORYSTATS_HPP
+#define MEMORYSTATS_HPP
+
+// Resident set size of the process in bytes, 0 when the platform does not
+// report it
+size_t getResidentBytes();
+
+// Highest resident set size the process has reached so far
+size_t getPeakResidentBytes();
+
+#endif
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <string>
+#include <utility>
+#include <cstddef>
+#include <GL/glew.h>
+
+#include "vertex.hpp"
+#include "face.hpp"
+#include "objloader.hpp"
+
+#include "mesh.hpp"
+
+Mesh::Mesh(const std::string& filePath, const ObjLoadOptions& options)
+    : Mesh(filePath, options, ObjLoader(filePath, options)) {
+}
+
+Mesh::Mesh(const std::string& filePath, const ObjLoadOptions& options, ObjLoader&& loaded)
+    : vao(0), vbo(0), ebo(0), indexType(GL_UNSIGNED_INT), objLoader(std::move(loaded)),
+      _filePath(filePath), _indexBytes(0), _indexBytesSaved(0) {
+    // Create Vertex Array Object (VAO)
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    // Create Vertex Buffer Object (VBO), cached meshes upload straight from the mapping
+    size_t stride = vertexStride(objLoader.getVertexFormat());
+    vbo = createVertexBuffer(objLoader.getVertexData(), objLoader.getVertexCount(), stride);
+
+    // Create Element Buffer Object (EBO), indices are already in their upload width
+    ebo = createElementBuffer(objLoader.getIndexData(), objLoader.getFaceCount(), objLoader.getIndexSize());
+
+    // Vertex layout, also used by instanced VAOs of this mesh
+    bindVertexAttributes();
+
+    // Unbind VAO and VBO, the EBO binding stays recorded in the VAO
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    // The GPU has its own copy now, drop what the level does not need
+    if (options.retention != MeshRetentionAll) {
+        size_t before = objLoader.getDataBytes();
+        objLoader.releaseData();
+        size_t after = objLoader.getDataBytes();
+        std::cerr << "Released CPU mesh data " << filePath << ": " << before / 1024 << " KB -> " << after / 1024 << " KB";
+        if (options.retention == MeshRetentionCollision) {
+            std::cerr << " (collision " << objLoader.getCollisionFaces().size() << " triangles)";
+        }
+        std::cerr << std::endl;
+    }
+}
+
+Mesh::~Mesh() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteBuffers(1, &ebo);
+}
+
+const std::string& Mesh::getFilePath() const {
+    return _filePath;
+}
+
+size_t Mesh::getIndexBytes() const {
+    return _indexBytes;
+}
+
+size_t Mesh::getIndexBytesSaved() const {
+    return _indexBytesSaved;
+}
+
+void Mesh::bindVertexAttributes() const {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (objLoader.getVertexFormat() == VertexFormatQuantized) {
+        // unorm16 position against the mesh bounds, the shader rescales it
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+        glEnableVertexAttribArray(0);
+
+        // Octahedral snorm16 normal, decoded in the shader
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, nU));
+        glEnableVertexAttribArray(1);
+    } else {
+        // Specify the layout of the vertex data
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // Specify the layout of the normal data
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+}
+
+GLuint Mesh::createVertexBuffer(const void* vertices, size_t count, size_t stride) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, count * stride, vertices, GL_STATIC_DRAW);
+    return buffer;
+}
+
+GLuint Mesh::createElementBuffer(const void* indices, size_t count, size_t indexSize) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+
+    size_t bytes = count * 3 * indexSize;
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, indices, GL_STATIC_DRAW);
+    indexType = indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    _indexBytes = bytes;
+    _indexBytesSaved = count * sizeof(Face) - bytes;
+    return buffer;
+}
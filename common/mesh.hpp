@@ -0,0 +1,44 @@
+#include <string>
+#include "objloader.hpp"
+
+#ifndef MESH_HPP
+#define MESH_HPP
+
+// GPU buffers and CPU metadata of one loaded OBJ file, shared by every
+// Object that draws it. The buffers are deleted with the last reference,
+// so a Mesh must not outlive the GL context.
+class Mesh {
+public:
+    Mesh(const std::string& filePath, const ObjLoadOptions& options);
+    // Uploads a mesh parsed elsewhere, e.g. on a loader thread
+    Mesh(const std::string& filePath, const ObjLoadOptions& options, ObjLoader&& loaded);
+    ~Mesh();
+
+    const std::string& getFilePath() const;
+
+    // Element buffer bytes uploaded, and bytes saved by 16-bit indices
+    size_t getIndexBytes() const;
+    size_t getIndexBytesSaved() const;
+
+    // Points attributes 0 and 1 of the bound VAO at the vertex buffer, for
+    // VAOs that draw this mesh with extra per-instance attributes
+    void bindVertexAttributes() const;
+
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    GLenum indexType;   // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    ObjLoader objLoader;
+private:
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    std::string _filePath;
+    size_t _indexBytes;
+    size_t _indexBytesSaved;
+
+    GLuint createVertexBuffer(const void* vertices, size_t count, size_t stride);
+    GLuint createElementBuffer(const void* indices, size_t count, size_t indexSize);
+};
+
+#endif
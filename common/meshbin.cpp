@@ -0,0 +1,161 @@
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "vertex.hpp"
+#include "face.hpp"
+#include "bounds.hpp"
+#include "mappedfile.hpp"
+
+#include "meshbin.hpp"
+
+static const char meshBinMagic[8] = { 'M', 'E', 'S', 'H', 'B', 'I', 'N', 0 };
+
+static inline uint64_t alignTo16(uint64_t offset) {
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+uint64_t hashBytes(const char* data, size_t size) {
+    // FNV-1a over 64-bit words, then the tail byte by byte
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        memcpy(&word, data + i * 8, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (size_t i = words * 8; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+    return hash;
+}
+
+std::string meshBinPath(const std::string& sourcePath, VertexFormat format, const std::vector<float>& lodRatios) {
+    std::string path = sourcePath;
+    if (!lodRatios.empty()) {
+        path += ".lods";
+        for (float ratio : lodRatios) {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "_%g", ratio);
+            path += buffer;
+        }
+    }
+    return path + (format == VertexFormatQuantized ? ".quantized.meshbin" : ".meshbin");
+}
+
+const MeshBinHeader* validateMeshBin(const MappedFile& file, uint64_t sourceSize, uint64_t sourceHash,
+    uint32_t vertexFormat, uint32_t cookFlags, const std::vector<float>& lodRatios) {
+    if (file.getSize() < sizeof(MeshBinHeader)) {
+        return nullptr;
+    }
+
+    const MeshBinHeader* header = (const MeshBinHeader*)file.getData();
+    if (memcmp(header->magic, meshBinMagic, sizeof(meshBinMagic)) != 0
+        || header->version != MeshBinVersion
+        || header->vertexFormat != vertexFormat
+        || header->indexSize != indexSize(header->vertexCount)
+        || header->cookFlags != cookFlags
+        || header->sourceSize != sourceSize
+        || header->sourceHash != sourceHash
+        || header->lodCount == 0
+        || header->lodCount > lodRatios.size() + 1
+        || header->lodCount > MaxMeshLods) {
+        return nullptr;
+    }
+
+    // Levels that did not reduce were left out while cooking, so the stored
+    // ratios are the requested ones in order with gaps
+    uint64_t faceCount = header->lodFaceCounts[0];
+    size_t next = 0;
+    for (uint32_t i = 1; i < header->lodCount; i++) {
+        while (next < lodRatios.size() && lodRatios[next] != header->lodRatios[i]) {
+            next++;
+        }
+        if (next == lodRatios.size()) {
+            return nullptr;
+        }
+        next++;
+        faceCount += header->lodFaceCounts[i];
+    }
+    if (faceCount != header->faceCount) {
+        return nullptr;
+    }
+
+    // A truncated write must not be read past the end of the mapping
+    uint64_t vertexEnd = header->vertexOffset + header->vertexCount * vertexStride((VertexFormat)vertexFormat);
+    uint64_t faceEnd = header->faceOffset + header->faceCount * 3 * header->indexSize;
+    if (vertexEnd > file.getSize() || faceEnd > file.getSize()
+        || header->vertexOffset % 16 != 0 || header->faceOffset % 16 != 0) {
+        return nullptr;
+    }
+
+    return header;
+}
+
+bool writeMeshBin(const std::string& filePath, uint64_t sourceSize, uint64_t sourceHash, uint32_t cookFlags, const Bounds& bounds,
+    VertexFormat vertexFormat, const void* vertices, size_t vertexCount, const void* indices,
+    const std::vector<float>& lodRatios, const std::vector<size_t>& lodFaceCounts) {
+    size_t stride = vertexStride(vertexFormat);
+    size_t faceBytes = 3 * indexSize(vertexCount);
+    if (lodFaceCounts.size() > MaxMeshLods || lodFaceCounts.size() != lodRatios.size() + 1) {
+        return false;
+    }
+    size_t faceCount = 0;
+    for (size_t count : lodFaceCounts) {
+        faceCount += count;
+    }
+    MeshBinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, meshBinMagic, sizeof(meshBinMagic));
+    header.version = MeshBinVersion;
+    header.vertexFormat = vertexFormat;
+    header.indexSize = (uint32_t)indexSize(vertexCount);
+    header.cookFlags = cookFlags;
+    header.sourceSize = sourceSize;
+    header.sourceHash = sourceHash;
+    header.vertexCount = vertexCount;
+    header.faceCount = faceCount;
+    header.vertexOffset = alignTo16(sizeof(MeshBinHeader));
+    header.faceOffset = alignTo16(header.vertexOffset + vertexCount * stride);
+    header.bounds = bounds;
+    header.lodCount = (uint32_t)lodFaceCounts.size();
+    header.lodRatios[0] = 1.0f;
+    for (size_t i = 0; i < lodFaceCounts.size(); i++) {
+        if (i > 0) {
+            header.lodRatios[i] = lodRatios[i - 1];
+        }
+        header.lodFaceCounts[i] = lodFaceCounts[i];
+    }
+
+    // Write to a temporary file and rename it so readers never see half a
+    // file. The name is unique per writer, loader threads may cook the same
+    // sidecar at once.
+    static std::atomic<unsigned int> writeCount(0);
+    std::string tempPath = filePath + ".tmp." + std::to_string(getpid()) + "." + std::to_string(writeCount++);
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error writing mesh cache: " << tempPath << std::endl;
+        return false;
+    }
+
+    static const char padding[16] = { 0 };
+    uint64_t vertexBytes = vertexCount * stride;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(padding, 1, header.vertexOffset - sizeof(header), file) == header.vertexOffset - sizeof(header)
+        && (vertexCount == 0 || fwrite(vertices, stride, vertexCount, file) == vertexCount)
+        && fwrite(padding, 1, header.faceOffset - header.vertexOffset - vertexBytes, file) == header.faceOffset - header.vertexOffset - vertexBytes
+        && (faceCount == 0 || fwrite(indices, faceBytes, faceCount, file) == faceCount);
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        std::cerr << "Error writing mesh cache: " << filePath << std::endl;
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vertex.hpp"
+#include "face.hpp"
+#include "bounds.hpp"
+
+#ifndef MESHBIN_HPP
+#define MESHBIN_HPP
+
+class MappedFile;
+
+// Cooked mesh sidecar written next to a source OBJ file. The header is
+// followed by the raw vertex and index arrays, each 16 byte aligned, in the
+// native byte order so they can be handed to glBufferData straight from a
+// mapping. Bump the version whenever the layout or the cooking changes.
+static const uint32_t MeshBinVersion = 10;
+
+// Levels of detail stored per sidecar, including the full mesh
+static const size_t MaxMeshLods = 8;
+
+// Processing applied while cooking, a sidecar cooked with different
+// options than the current load is rebuilt
+enum MeshBinCookFlags {
+    MeshBinCookOptimized = 1    // Vertex cache and fetch order optimized
+};
+
+struct MeshBinHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexFormat;      // VertexFormat
+    uint32_t cookFlags;
+    uint32_t indexSize;         // indexSize(vertexCount), 2 or 4 bytes
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t vertexCount;
+    uint64_t faceCount;
+    uint64_t vertexOffset;
+    uint64_t faceOffset;
+    Bounds bounds;
+
+    // The index array holds every LOD back to back, LOD 0 is the full mesh
+    // and lodRatios[i] is the triangle ratio LOD i was simplified to. Ratios
+    // whose level did not reduce the one before are not stored.
+    uint32_t lodCount;
+    float lodRatios[MaxMeshLods];
+    uint64_t lodFaceCounts[MaxMeshLods];
+};
+
+// Fast non-cryptographic 64-bit hash used to detect source changes
+uint64_t hashBytes(const char* data, size_t size);
+
+// Each vertex format and set of LOD ratios gets its own sidecar, e.g.
+// teapot.obj.lods_0.5_0.25.quantized.meshbin, so meshes loaded with
+// different options do not keep invalidating each other
+std::string meshBinPath(const std::string& sourcePath, VertexFormat format, const std::vector<float>& lodRatios);
+
+// Returns the header if the mapped sidecar is intact and was cooked from a
+// source with the given size and hash, nullptr if it has to be rebuilt
+const MeshBinHeader* validateMeshBin(const MappedFile& file, uint64_t sourceSize, uint64_t sourceHash,
+    uint32_t vertexFormat, uint32_t cookFlags, const std::vector<float>& lodRatios);
+
+bool writeMeshBin(const std::string& filePath, uint64_t sourceSize, uint64_t sourceHash, uint32_t cookFlags, const Bounds& bounds,
+    VertexFormat vertexFormat, const void* vertices, size_t vertexCount, const void* indices,
+    const std::vector<float>& lodRatios, const std::vector<size_t>& lodFaceCounts);
+
+#endif
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "vertex.hpp"
+#include "face.hpp"
+
+#include "meshoptimizer.hpp"
+
+VertexCacheStats analyzeVertexCache(const Face* faces, size_t faceCount, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (faceCount == 0 || vertexCount == 0 || cacheSize == 0) {
+        return stats;
+    }
+
+    // timestamps[v] is the miss counter when v entered the cache, it is still
+    // cached while fewer than cacheSize misses happened since then
+    std::vector<size_t> timestamps(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t i = 0; i < faceCount; i++) {
+        const unsigned int corners[3] = { faces[i].v1, faces[i].v2, faces[i].v3 };
+        for (int c = 0; c < 3; c++) {
+            unsigned int v = corners[c];
+            if (v >= vertexCount) {
+                continue;
+            }
+            if (timestamps[v] == 0 || misses + 1 - timestamps[v] > cacheSize) {
+                misses++;
+                timestamps[v] = misses;
+            }
+        }
+    }
+
+    stats.acmr = (float)misses / faceCount;
+    stats.atvr = (float)misses / vertexCount;
+    return stats;
+}
+
+// Cache the order is built for, the same FIFO analyzeVertexCache simulates
+// by default. Adjacency lists longer than maxValence are not scanned for
+// candidates, their triangles are still reached through their other
+// corners or the fallback cursor.
+static const int cacheSize = 16;
+static const unsigned int maxValence = 32;
+
+// Scores tuned against analyzeVertexCache on teapot.obj, shuffled copies of
+// it and a regular grid. Entries do not move on a hit in a FIFO, so a
+// cached vertex scores more the older it is, it is the next to be lost.
+static const float cacheHitScore = 3.28f;
+static const float cacheAgeScale = 0.48f;
+static const float cacheAgePower = 0.59f;
+
+// Vertices with few triangles left score higher, finishing them frees their
+// cache entry. Indexed by triangles left - 1, the last entry covers the rest.
+static const float valenceScores[] = { 2.42f, 2.36f, 2.06f, 1.57f, 0.71f };
+static const unsigned int valenceSteps = sizeof(valenceScores) / sizeof(valenceScores[0]);
+
+// Windows of the greedy order are tried again against the exact cache and
+// kept when the window and the triangles after it miss less
+static const size_t refineWindow = 32;
+static const unsigned int refineValenceCap = 8;
+
+// Score lookup table, filled once by the constructor
+struct ScoreTables {
+    float cache[cacheSize];
+
+    ScoreTables() {
+        for (int i = 0; i < cacheSize; i++) {
+            cache[i] = cacheHitScore + cacheAgeScale * powf((float)(i + 1) / cacheSize, cacheAgePower);
+        }
+    }
+};
+
+// Loader workers optimize meshes concurrently. A function-local static is
+// initialized exactly once even when several threads get here first.
+static const ScoreTables& scoreTables() {
+    static const ScoreTables tables;
+    return tables;
+}
+
+// FIFO post-transform cache. A vertex stays cached until cacheSize misses
+// happened after it was loaded. Changes made after mark() can be rolled
+// back, so a different order can be tried from the same state.
+class FifoCache {
+public:
+    explicit FifoCache(size_t vertexCount) : _stamps(vertexCount, 0), _misses(0), _markMisses(0), _marked(false) {}
+
+    // 0 for the newest entry, -1 when not cached
+    int age(unsigned int v) const {
+        size_t age = _misses - _stamps[v];
+        return _stamps[v] != 0 && age < (size_t)cacheSize ? (int)age : -1;
+    }
+
+    // Returns true when v missed and was loaded
+    bool addVertex(unsigned int v) {
+        if (age(v) >= 0) {
+            return false;
+        }
+        if (_marked) {
+            _log.push_back(std::make_pair(v, _stamps[v]));
+        }
+        _misses++;
+        _stamps[v] = _misses;
+        return true;
+    }
+
+    void addFace(const Face& face) {
+        addVertex(face.v1);
+        addVertex(face.v2);
+        addVertex(face.v3);
+    }
+
+    size_t getMisses() const {
+        return _misses;
+    }
+
+    void mark() {
+        _log.clear();
+        _markMisses = _misses;
+        _marked = true;
+    }
+
+    void rollback() {
+        for (size_t i = _log.size(); i > 0; i--) {
+            _stamps[_log[i - 1].first] = _log[i - 1].second;
+        }
+        _log.clear();
+        _misses = _markMisses;
+        _marked = false;
+    }
+
+private:
+    std::vector<size_t> _stamps;
+    std::vector<std::pair<unsigned int, size_t> > _log;
+    size_t _misses;
+    size_t _markMisses;
+    bool _marked;
+};
+
+static inline float vertexScore(const ScoreTables& tables, const FifoCache& cache, unsigned int v, unsigned int remaining) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+    int age = cache.age(v);
+    float score = age >= 0 ? tables.cache[age] : 0.0f;
+    return score + valenceScores[remaining < valenceSteps ? remaining - 1 : valenceSteps - 1];
+}
+
+static inline float triangleScore(const ScoreTables& tables, const FifoCache& cache, const Face& face,
+    const std::vector<unsigned int>& remaining) {
+    return vertexScore(tables, cache, face.v1, remaining[face.v1])
+        + vertexScore(tables, cache, face.v2, remaining[face.v2])
+        + vertexScore(tables, cache, face.v3, remaining[face.v3]);
+}
+
+// Reorders short windows of faces greedily from the cache state before them
+static void refineVertexCache(std::vector<Face>& faces, size_t vertexCount) {
+    size_t faceCount = faces.size();
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (const Face& face : faces) {
+        remaining[face.v1]++;
+        remaining[face.v2]++;
+        remaining[face.v3]++;
+    }
+
+    FifoCache cache(vertexCount);
+    std::vector<Face> trial;
+    std::vector<bool> used;
+    for (size_t start = 0; start < faceCount; start += refineWindow / 2) {
+        size_t count = std::min(refineWindow, faceCount - start);
+        size_t end = std::min(start + count + refineWindow, faceCount);
+
+        // Misses of the current order over the window and the one after it
+        cache.mark();
+        for (size_t i = start; i < end; i++) {
+            cache.addFace(faces[i]);
+        }
+        size_t currentMisses = cache.getMisses();
+        cache.rollback();
+
+        cache.mark();
+        trial.clear();
+        used.assign(count, false);
+        for (size_t step = 0; step < count; step++) {
+            // Hits first, then the oldest cached corners before FIFO drops them
+            size_t best = count;
+            long bestKey = 0;
+            for (size_t j = 0; j < count; j++) {
+                if (used[j]) continue;
+                const Face& face = faces[start + j];
+                unsigned int corners[3] = { face.v1, face.v2, face.v3 };
+                long key = 0;
+                for (int c = 0; c < 3; c++) {
+                    int age = cache.age(corners[c]);
+                    if (age >= 0) key += 1000 + age;
+                    key -= std::min(remaining[corners[c]], refineValenceCap);
+                }
+                if (best == count || key > bestKey) {
+                    best = j;
+                    bestKey = key;
+                }
+            }
+            const Face& face = faces[start + best];
+            used[best] = true;
+            trial.push_back(face);
+            cache.addFace(face);
+            remaining[face.v1]--;
+            remaining[face.v2]--;
+            remaining[face.v3]--;
+        }
+        for (size_t i = start + count; i < end; i++) {
+            cache.addFace(faces[i]);
+        }
+        size_t trialMisses = cache.getMisses();
+        cache.rollback();
+        for (const Face& face : trial) {
+            remaining[face.v1]++;
+            remaining[face.v2]++;
+            remaining[face.v3]++;
+        }
+        if (trialMisses < currentMisses) {
+            std::copy(trial.begin(), trial.end(), faces.begin() + start);
+        }
+
+        // Move on by half a window, so every boundary is inside a window once
+        size_t next = std::min(start + refineWindow / 2, faceCount);
+        for (size_t i = start; i < next; i++) {
+            cache.addFace(faces[i]);
+            remaining[faces[i].v1]--;
+            remaining[faces[i].v2]--;
+            remaining[faces[i].v3]--;
+        }
+    }
+}
+
+void optimizeVertexCache(std::vector<Face>& faces, size_t vertexCount) {
+    size_t faceCount = faces.size();
+    if (faceCount == 0 || vertexCount == 0) {
+        return;
+    }
+    const ScoreTables& tables = scoreTables();
+
+    // Triangles adjacent to each vertex, packed into one array. Emitted
+    // triangles are dropped from a list lazily, when it is next scanned.
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (const Face& face : faces) {
+        remaining[face.v1]++;
+        remaining[face.v2]++;
+        remaining[face.v3]++;
+    }
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<unsigned int> adjacency(offsets[vertexCount]);
+    std::vector<size_t> ends(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < faceCount; i++) {
+        adjacency[ends[faces[i].v1]++] = (unsigned int)i;
+        adjacency[ends[faces[i].v2]++] = (unsigned int)i;
+        adjacency[ends[faces[i].v3]++] = (unsigned int)i;
+    }
+
+    FifoCache cache(vertexCount);
+    std::vector<bool> emitted(faceCount, false);
+    std::vector<Face> output;
+    output.reserve(faceCount);
+
+    // Vertices that entered the cache, oldest first, pruned as they leave
+    std::vector<unsigned int> cached;
+    cached.reserve(cacheSize + 3);
+
+    // Start where the input starts, exporters tend to begin at an edge
+    size_t best = 0;
+    float bestScore = 0.0f;
+    size_t cursor = 0;
+
+    while (output.size() < faceCount) {
+        const Face face = faces[best];
+        output.push_back(face);
+        emitted[best] = true;
+
+        const unsigned int corners[3] = { face.v1, face.v2, face.v3 };
+        for (int c = 0; c < 3; c++) {
+            remaining[corners[c]]--;
+            if (cache.addVertex(corners[c])) {
+                cached.push_back(corners[c]);
+            }
+        }
+        size_t kept = 0;
+        for (unsigned int v : cached) {
+            if (cache.age(v) >= 0) {
+                cached[kept++] = v;
+            }
+        }
+        cached.resize(kept);
+
+        // Best triangle around the cached vertices, skipping the lists of
+        // vertices with too many triangles left to scan every time
+        best = faceCount;
+        bestScore = 0.0f;
+        for (unsigned int v : cached) {
+            if (remaining[v] == 0 || remaining[v] > maxValence) {
+                continue;
+            }
+            unsigned int* list = &adjacency[offsets[v]];
+            size_t live = 0;
+            for (size_t k = 0; k < ends[v] - offsets[v]; k++) {
+                unsigned int t = list[k];
+                if (emitted[t]) continue;
+                list[live++] = t;
+                float score = triangleScore(tables, cache, faces[t], remaining);
+                if (best == faceCount || score > bestScore) {
+                    best = t;
+                    bestScore = score;
+                }
+            }
+            ends[v] = offsets[v] + live;
+        }
+
+        // Nothing left around the cache, continue with the next unused triangle
+        if (best == faceCount) {
+            while (cursor < faceCount && emitted[cursor]) {
+                cursor++;
+            }
+            best = cursor;
+        }
+    }
+
+    faces.swap(output);
+    refineVertexCache(faces, vertexCount);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<Face>& faces) {
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+
+    for (Face& face : faces) {
+        unsigned int* corners[3] = { &face.v1, &face.v2, &face.v3 };
+        for (int c = 0; c < 3; c++) {
+            unsigned int& index = *corners[c];
+            if (remap[index] == unused) {
+                remap[index] = (unsigned int)ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+    }
+
+    // Keep unreferenced vertices at the end so the vertex count is unchanged
+    for (size_t v = 0; v < vertices.size(); v++) {
+        if (remap[v] == unused) {
+            ordered.push_back(vertices[v]);
+        }
+    }
+
+    vertices.swap(ordered);
+}
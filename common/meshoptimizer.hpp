@@ -0,0 +1,27 @@
+#include <vector>
+#include "vertex.hpp"
+#include "face.hpp"
+
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+struct VertexCacheStats {
+    float acmr;     // Average cache miss ratio, transformed vertices per triangle
+    float atvr;     // Average transform to vertex ratio, 1.0 is ideal
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries over the index
+// buffer. Runs on the CPU so results do not depend on the GPU in use.
+VertexCacheStats analyzeVertexCache(const Face* faces, size_t faceCount, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Reorders triangles for post-transform cache locality. Greedy in the
+// style of Tom Forsyth's "Linear-Speed Vertex Cache Optimisation", scored
+// for the 16-entry FIFO analyzeVertexCache simulates, then refined in short
+// windows against that simulator.
+void optimizeVertexCache(std::vector<Face>& faces, size_t vertexCount);
+
+// Reorders vertices into the order the index buffer first uses them and
+// remaps the indices, so vertex fetch walks memory front to back
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<Face>& faces);
+
+#endif
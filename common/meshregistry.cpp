@@ -0,0 +1,157 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <GL/glew.h>
+
+#include "mappedfile.hpp"
+#include "meshbin.hpp"
+#include "mesh.hpp"
+
+#include "meshregistry.hpp"
+
+// Only options that change the uploaded or retained data split the cache
+static std::string optionsKey(const ObjLoadOptions& options) {
+    std::ostringstream key;
+    key << "|format " << options.vertexFormat << "|optimize " << options.optimize << "|lods";
+    for (float ratio : options.lodRatios) {
+        key << " " << ratio;
+    }
+    key << "|retention " << options.retention;
+    if (options.retention == MeshRetentionCollision) {
+        key << " " << options.collisionRatio;
+    }
+    return key.str();
+}
+
+MeshRegistry::MeshRegistry() : _hits(0), _misses(0) {
+}
+
+std::shared_ptr<Mesh> MeshRegistry::find(std::map<std::string, std::weak_ptr<Mesh>>& meshes, const std::string& key) {
+    std::map<std::string, std::weak_ptr<Mesh>>::iterator it = meshes.find(key);
+    if (it == meshes.end()) {
+        return std::shared_ptr<Mesh>();
+    }
+    std::shared_ptr<Mesh> mesh = it->second.lock();
+    if (!mesh) {
+        meshes.erase(it);
+    }
+    return mesh;
+}
+
+std::string MeshRegistry::pathKey(const std::string& filePath, const ObjLoadOptions& options) {
+    return canonicalPath(filePath) + optionsKey(options);
+}
+
+std::string MeshRegistry::contentKey(const std::string& filePath, const ObjLoadOptions& options) {
+    MappedFile file;
+    if (!file.open(filePath)) {
+        return "missing " + pathKey(filePath, options);
+    }
+    std::ostringstream key;
+    key << std::hex << hashBytes(file.getData(), file.getSize()) << std::dec << " " << file.getSize() << optionsKey(options);
+    return key.str();
+}
+
+std::shared_ptr<Mesh> MeshRegistry::findPath(const std::string& filePath, const std::string& pathKey) {
+    std::shared_ptr<Mesh> mesh = find(_byPath, pathKey);
+    if (mesh) {
+        _hits++;
+        std::cerr << "Mesh cache hit: " << filePath << std::endl;
+    }
+    return mesh;
+}
+
+// A copy of an already loaded file under another name shares its mesh
+std::shared_ptr<Mesh> MeshRegistry::findContent(const std::string& filePath, const std::string& pathKey, const std::string& contentKey) {
+    std::shared_ptr<Mesh> mesh = find(_byContent, contentKey);
+    if (mesh) {
+        _hits++;
+        _byPath[pathKey] = mesh;
+        std::cerr << "Mesh cache hit: " << filePath << " (same content as " << mesh->getFilePath() << ")" << std::endl;
+    }
+    return mesh;
+}
+
+void MeshRegistry::insert(const std::shared_ptr<Mesh>& mesh, const std::string& pathKey, const std::string& contentKey) {
+    _byPath[pathKey] = mesh;
+    _byContent[contentKey] = mesh;
+}
+
+std::shared_ptr<Mesh> MeshRegistry::acquire(const std::string& filePath, const ObjLoadOptions& options) {
+    std::string path = pathKey(filePath, options);
+    std::shared_ptr<Mesh> mesh = findPath(filePath, path);
+    if (mesh) {
+        return mesh;
+    }
+
+    std::string content = contentKey(filePath, options);
+    mesh = findContent(filePath, path, content);
+    if (mesh) {
+        return mesh;
+    }
+
+    _misses++;
+    std::cerr << "Mesh cache miss: " << filePath << std::endl;
+    mesh = std::make_shared<Mesh>(filePath, options);
+    insert(mesh, path, content);
+    return mesh;
+}
+
+std::shared_ptr<Mesh> MeshRegistry::acquireLoaded(const std::string& filePath, const ObjLoadOptions& options,
+                                                  const std::string& contentKey, ObjLoader&& loaded) {
+    std::string path = pathKey(filePath, options);
+    std::shared_ptr<Mesh> mesh = findPath(filePath, path);
+    if (!mesh) {
+        mesh = findContent(filePath, path, contentKey);
+    }
+    if (mesh) {
+        return mesh;
+    }
+
+    _misses++;
+    std::cerr << "Mesh cache miss: " << filePath << std::endl;
+    mesh = std::make_shared<Mesh>(filePath, options, std::move(loaded));
+    insert(mesh, path, contentKey);
+    return mesh;
+}
+
+size_t MeshRegistry::getHits() const {
+    return _hits;
+}
+
+size_t MeshRegistry::getMisses() const {
+    return _misses;
+}
+
+size_t MeshRegistry::getMeshCount() const {
+    size_t count = 0;
+    for (const auto& entry : _byContent) {
+        if (!entry.second.expired()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t MeshRegistry::getIndexBytes() const {
+    size_t bytes = 0;
+    for (const auto& entry : _byContent) {
+        std::shared_ptr<Mesh> mesh = entry.second.lock();
+        if (mesh) {
+            bytes += mesh->getIndexBytes();
+        }
+    }
+    return bytes;
+}
+
+size_t MeshRegistry::getIndexBytesSaved() const {
+    size_t bytes = 0;
+    for (const auto& entry : _byContent) {
+        std::shared_ptr<Mesh> mesh = entry.second.lock();
+        if (mesh) {
+            bytes += mesh->getIndexBytesSaved();
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,50 @@
+#include <map>
+#include <memory>
+#include <string>
+#include "objloader.hpp"
+
+#ifndef MESHREGISTRY_HPP
+#define MESHREGISTRY_HPP
+
+class Mesh;
+
+// Hands out one shared Mesh per distinct OBJ file, so repeated props are
+// parsed and uploaded once. Meshes are looked up by canonical path first
+// and then by content hash, which also catches copies under another name.
+// The registry only holds weak references, a mesh is freed when the last
+// Object using it goes away.
+class MeshRegistry {
+public:
+    MeshRegistry();
+
+    std::shared_ptr<Mesh> acquire(const std::string& filePath, const ObjLoadOptions& options = ObjLoadOptions());
+
+    // Asynchronous loading splits acquire() so the parse runs on a worker.
+    // The keys and the ObjLoader are built off the GL thread, then
+    // acquireLoaded() uploads unless the path or content is already loaded.
+    static std::string pathKey(const std::string& filePath, const ObjLoadOptions& options);
+    static std::string contentKey(const std::string& filePath, const ObjLoadOptions& options);
+    std::shared_ptr<Mesh> acquireLoaded(const std::string& filePath, const ObjLoadOptions& options,
+                                        const std::string& contentKey, ObjLoader&& loaded);
+
+    size_t getHits() const;
+    size_t getMisses() const;
+
+    // Meshes still referenced, and their element buffer bytes
+    size_t getMeshCount() const;
+    size_t getIndexBytes() const;
+    size_t getIndexBytesSaved() const;
+
+private:
+    std::map<std::string, std::weak_ptr<Mesh>> _byPath;
+    std::map<std::string, std::weak_ptr<Mesh>> _byContent;
+    size_t _hits;
+    size_t _misses;
+
+    static std::shared_ptr<Mesh> find(std::map<std::string, std::weak_ptr<Mesh>>& meshes, const std::string& key);
+    std::shared_ptr<Mesh> findPath(const std::string& filePath, const std::string& pathKey);
+    std::shared_ptr<Mesh> findContent(const std::string& filePath, const std::string& pathKey, const std::string& contentKey);
+    void insert(const std::shared_ptr<Mesh>& mesh, const std::string& pathKey, const std::string& contentKey);
+};
+
+#endif
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "vertex.hpp"
+#include "face.hpp"
+
+#include "meshsimplifier.hpp"
+
+// Symmetric 4x4 error quadric, upper triangle only
+struct Quadric {
+    double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+};
+
+static void addPlane(Quadric& q, double a, double b, double c, double d, double weight) {
+    q.a2 += weight * a * a; q.ab += weight * a * b; q.ac += weight * a * c; q.ad += weight * a * d;
+    q.b2 += weight * b * b; q.bc += weight * b * c; q.bd += weight * b * d;
+    q.c2 += weight * c * c; q.cd += weight * c * d;
+    q.d2 += weight * d * d;
+}
+
+static void addQuadric(Quadric& q, const Quadric& other) {
+    q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+    q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+    q.c2 += other.c2; q.cd += other.cd;
+    q.d2 += other.d2;
+}
+
+static double evaluate(const Quadric& q, const Vertex& p) {
+    double x = p.x, y = p.y, z = p.z;
+    return q.a2 * x * x + 2 * q.ab * x * y + 2 * q.ac * x * z + 2 * q.ad * x
+         + q.b2 * y * y + 2 * q.bc * y * z + 2 * q.bd * y
+         + q.c2 * z * z + 2 * q.cd * z
+         + q.d2;
+}
+
+static void faceNormal(const Vertex& a, const Vertex& b, const Vertex& c, double n[3]) {
+    double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    double vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+    n[0] = uy * vz - uz * vy;
+    n[1] = uz * vx - ux * vz;
+    n[2] = ux * vy - uy * vx;
+}
+
+// Heap entry for collapsing from into to, stale once either vertex changed
+struct Collapse {
+    double cost;
+    unsigned int from, to;
+    unsigned int fromVersion, toVersion;
+
+    bool operator>(const Collapse& other) const {
+        return cost > other.cost;
+    }
+};
+
+// Fewest triangles a simplified mesh keeps, the smallest closed mesh
+static const size_t minFaceCount = 4;
+
+std::vector<Face> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<Face>& faces, size_t targetFaceCount) {
+    size_t vertexCount = vertices.size();
+    size_t floorFaceCount = std::max(targetFaceCount, minFaceCount);
+    if (faces.size() <= floorFaceCount || vertexCount == 0) {
+        return faces;
+    }
+
+    // Weld vertices that share a position (flat shading, normal seams) so
+    // every copy of a position collapses as one. The copies of position p
+    // are order[copyOffsets[p]] up to order[copyOffsets[p + 1]].
+    std::vector<unsigned int> order(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        order[v] = (unsigned int)v;
+    }
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        const Vertex& p = vertices[a];
+        const Vertex& q = vertices[b];
+        if (p.x != q.x) return p.x < q.x;
+        if (p.y != q.y) return p.y < q.y;
+        return p.z < q.z;
+    });
+    std::vector<Vertex> positions;
+    std::vector<size_t> copyOffsets;
+    std::vector<unsigned int> positionOf(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const Vertex& p = vertices[order[i]];
+        if (positions.empty() || p.x != positions.back().x || p.y != positions.back().y || p.z != positions.back().z) {
+            positions.push_back(p);
+            copyOffsets.push_back(i);
+        }
+        positionOf[order[i]] = (unsigned int)(positions.size() - 1);
+    }
+    copyOffsets.push_back(vertexCount);
+    size_t positionCount = positions.size();
+
+    // triangles index positions, corners keeps the vertices each triangle
+    // draws with. Triangles without area once welded are dropped.
+    std::vector<Face> triangles;
+    std::vector<Face> corners;
+    triangles.reserve(faces.size());
+    corners.reserve(faces.size());
+    for (const Face& face : faces) {
+        Face welded = { positionOf[face.v1], positionOf[face.v2], positionOf[face.v3] };
+        if (welded.v1 != welded.v2 && welded.v2 != welded.v3 && welded.v3 != welded.v1) {
+            triangles.push_back(welded);
+            corners.push_back(face);
+        }
+    }
+
+    // The copy of position p whose normal is closest to vertex v's, so a
+    // corner moved across a seam keeps drawing with its own side's normal
+    std::function<unsigned int(unsigned int, unsigned int)> closestCopy = [&](unsigned int p, unsigned int v) {
+        const Vertex& normal = vertices[v];
+        unsigned int best = order[copyOffsets[p]];
+        float bestDot = -2.0f;
+        for (size_t i = copyOffsets[p]; i < copyOffsets[p + 1]; i++) {
+            const Vertex& copy = vertices[order[i]];
+            float dot = normal.nX * copy.nX + normal.nY * copy.nY + normal.nZ * copy.nZ;
+            if (dot > bestDot) {
+                best = order[i];
+                bestDot = dot;
+            }
+        }
+        return best;
+    };
+
+    // Triangles around each position
+    std::vector<std::vector<unsigned int> > vertexTriangles(positionCount);
+    for (size_t i = 0; i < triangles.size(); i++) {
+        vertexTriangles[triangles[i].v1].push_back((unsigned int)i);
+        vertexTriangles[triangles[i].v2].push_back((unsigned int)i);
+        vertexTriangles[triangles[i].v3].push_back((unsigned int)i);
+    }
+
+    // Lock open borders, an edge of the welded mesh used by a single triangle
+    std::vector<bool> locked(positionCount, false);
+    {
+        std::unordered_map<uint64_t, unsigned int> edgeUses;
+        edgeUses.reserve(triangles.size() * 3);
+        for (const Face& face : triangles) {
+            const unsigned int ends[3] = { face.v1, face.v2, face.v3 };
+            for (int c = 0; c < 3; c++) {
+                unsigned int a = ends[c], b = ends[(c + 1) % 3];
+                uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+                edgeUses[key]++;
+            }
+        }
+        for (std::unordered_map<uint64_t, unsigned int>::const_iterator it = edgeUses.begin(); it != edgeUses.end(); ++it) {
+            if (it->second == 1) {
+                locked[(unsigned int)(it->first >> 32)] = true;
+                locked[(unsigned int)(it->first & 0xffffffffu)] = true;
+            }
+        }
+    }
+
+    // Area weighted plane quadrics
+    Quadric zero;
+    memset(&zero, 0, sizeof(zero));
+    std::vector<Quadric> quadrics(positionCount, zero);
+    for (const Face& face : triangles) {
+        double n[3];
+        faceNormal(positions[face.v1], positions[face.v2], positions[face.v3], n);
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0) {
+            continue;
+        }
+        double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+        double d = -(a * positions[face.v1].x + b * positions[face.v1].y + c * positions[face.v1].z);
+        double area = length * 0.5;
+        addPlane(quadrics[face.v1], a, b, c, d, area);
+        addPlane(quadrics[face.v2], a, b, c, d, area);
+        addPlane(quadrics[face.v3], a, b, c, d, area);
+    }
+
+    std::vector<unsigned int> versions(positionCount, 0);
+    std::vector<bool> removedVertex(positionCount, false);
+    std::vector<bool> removedTriangle(triangles.size(), false);
+    // Min heap of collapses. Entries go stale instead of being removed, so
+    // the heap is compacted whenever it doubles past its live size.
+    std::vector<Collapse> heap;
+    std::greater<Collapse> heapOrder;
+    std::function<bool(const Collapse&)> isStale = [&](const Collapse& collapse) {
+        return removedVertex[collapse.from] || removedVertex[collapse.to]
+            || versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion;
+    };
+
+    // Queues every collapse of an unlocked position into a neighbour
+    std::vector<unsigned int> neighbours;
+    std::function<void(unsigned int)> pushCollapses = [&](unsigned int v) {
+        neighbours.clear();
+        for (unsigned int t : vertexTriangles[v]) {
+            if (removedTriangle[t]) continue;
+            const Face& face = triangles[t];
+            neighbours.push_back(face.v1);
+            neighbours.push_back(face.v2);
+            neighbours.push_back(face.v3);
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+        for (unsigned int w : neighbours) {
+            if (w == v) continue;
+            Quadric sum = quadrics[v];
+            addQuadric(sum, quadrics[w]);
+            if (!locked[v]) {
+                Collapse collapse = { evaluate(sum, positions[w]), v, w, versions[v], versions[w] };
+                heap.push_back(collapse);
+                std::push_heap(heap.begin(), heap.end(), heapOrder);
+            }
+            if (!locked[w]) {
+                Collapse collapse = { evaluate(sum, positions[v]), w, v, versions[w], versions[v] };
+                heap.push_back(collapse);
+                std::push_heap(heap.begin(), heap.end(), heapOrder);
+            }
+        }
+    };
+
+    for (unsigned int v = 0; v < positionCount; v++) {
+        if (!locked[v]) {
+            pushCollapses(v);
+        }
+    }
+
+    size_t liveTriangles = triangles.size();
+    size_t heapLimit = std::max(heap.size() * 2, (size_t)1024);
+    while (liveTriangles > floorFaceCount && !heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), heapOrder);
+        Collapse collapse = heap.back();
+        heap.pop_back();
+
+        unsigned int from = collapse.from, to = collapse.to;
+        if (isStale(collapse)) {
+            continue;
+        }
+
+        // Reject collapses that flip a remaining triangle around from, or
+        // that would take the mesh below its floor
+        bool flips = false;
+        size_t vanishing = 0;
+        for (unsigned int t : vertexTriangles[from]) {
+            if (removedTriangle[t]) continue;
+            const Face& face = triangles[t];
+            if (face.v1 == to || face.v2 == to || face.v3 == to) {
+                vanishing++;
+                continue;
+            }
+
+            double before[3], after[3];
+            faceNormal(positions[face.v1], positions[face.v2], positions[face.v3], before);
+            const Vertex& a = positions[face.v1 == from ? to : face.v1];
+            const Vertex& b = positions[face.v2 == from ? to : face.v2];
+            const Vertex& c = positions[face.v3 == from ? to : face.v3];
+            faceNormal(a, b, c, after);
+            if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips || liveTriangles - vanishing < floorFaceCount) {
+            continue;
+        }
+
+        // Move every triangle of from onto to, the ones on the edge vanish
+        for (unsigned int t : vertexTriangles[from]) {
+            if (removedTriangle[t]) continue;
+            Face& face = triangles[t];
+            if (face.v1 == to || face.v2 == to || face.v3 == to) {
+                removedTriangle[t] = true;
+                liveTriangles--;
+                continue;
+            }
+            Face& corner = corners[t];
+            if (face.v1 == from) { face.v1 = to; corner.v1 = closestCopy(to, corner.v1); }
+            if (face.v2 == from) { face.v2 = to; corner.v2 = closestCopy(to, corner.v2); }
+            if (face.v3 == from) { face.v3 = to; corner.v3 = closestCopy(to, corner.v3); }
+            vertexTriangles[to].push_back(t);
+        }
+        std::vector<unsigned int>().swap(vertexTriangles[from]);
+
+        // Drop the removed triangles from to's list while we are here
+        std::vector<unsigned int>& around = vertexTriangles[to];
+        around.erase(std::remove_if(around.begin(), around.end(),
+            [&](unsigned int t) { return removedTriangle[t]; }), around.end());
+
+        removedVertex[from] = true;
+        addQuadric(quadrics[to], quadrics[from]);
+        versions[to]++;
+        pushCollapses(to);
+
+        if (heap.size() > heapLimit) {
+            heap.erase(std::remove_if(heap.begin(), heap.end(), isStale), heap.end());
+            std::make_heap(heap.begin(), heap.end(), heapOrder);
+            heapLimit = std::max(heap.size() * 2, heapLimit);
+        }
+    }
+
+    std::vector<Face> result;
+    result.reserve(liveTriangles);
+    for (size_t t = 0; t < triangles.size(); t++) {
+        if (!removedTriangle[t]) {
+            result.push_back(corners[t]);
+        }
+    }
+    return result;
+}
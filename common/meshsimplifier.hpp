@@ -0,0 +1,16 @@
+#include <vector>
+#include "vertex.hpp"
+#include "face.hpp"
+
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+// Reduces faces to about targetFaceCount triangles by collapsing edges in
+// order of quadric error (Garland & Heckbert), but never below four. Vertices are never moved or
+// added, a collapse merges one endpoint into the other, so the result
+// indexes the same vertex buffer and can share it with the full mesh.
+// Copies of one position (flat shading, normal seams) collapse together,
+// only vertices on open borders are kept in place.
+std::vector<Face> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<Face>& faces, size_t targetFaceCount);
+
+#endif
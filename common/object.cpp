@@ -1,11 +1,67 @@
 #include <string>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
 
-#include "objloader.hpp"
+#include "mesh.hpp"
+#include "bounds.hpp"
+#include "instancebuffer.hpp"
 
 #include "object.hpp"
 
-Object::Object(const std::string& filePath) : objLoader(filePath) {
+Object::Object(const std::shared_ptr<Mesh>& mesh) : mesh(mesh), node(0) {
     
-}
\ No newline at end of file
+}
+
+glm::mat4 Object::getModelMatrix() const {
+    glm::vec3 myRotationAxis(0.0f, 1.0f, 0.0f);
+    glm::mat4 rotationMatrix = glm::rotate(angle, myRotationAxis);
+    glm::vec3 translation(locationX, locationY, locationZ);
+    glm::mat4 translationMatrix = glm::translate(translation);
+    glm::vec3 scale(1.0f, 1.0f, 1.0f);
+    glm::mat4 scaleMatrix = glm::scale(scale);
+    return translationMatrix * rotationMatrix * scaleMatrix;
+}
+
+RenderItem Object::createRenderItem() const {
+    const ObjLoader& objLoader = mesh->objLoader;
+    const Bounds& bounds = objLoader.getBounds();
+    glm::vec3 minimum(bounds.min[0], bounds.min[1], bounds.min[2]);
+    glm::vec3 maximum(bounds.max[0], bounds.max[1], bounds.max[2]);
+
+    RenderItem item;
+    item.model = getModelMatrix();
+    item.normalMatrix = glm::transpose(glm::inverse(glm::mat3(item.model)));
+    item.color = color;
+    item.boundsCenter = (minimum + maximum) * 0.5f;
+    item.boundsRadius = glm::length(maximum - minimum) * 0.5f;
+    item.positionOffset = minimum;
+    item.positionScale = maximum - minimum;
+    item.quantized = objLoader.getVertexFormat() == VertexFormatQuantized;
+    item.vao = mesh->vao;
+    item.programID = program->getID();
+    item.uniforms = &program->getLocations();
+    item.indexType = mesh->indexType;
+    item.instanceCount = 0;
+
+    // Instanced entries draw through their own VAO, and pick one level of
+    // detail for the whole group
+    if (instances) {
+        item.boundsCenter = instances->getBoundsCenter();
+        item.boundsRadius = instances->getBoundsRadius();
+        item.vao = instances->vao;
+        item.instanceCount = (uint32_t)instances->getInstanceCount();
+    }
+
+    size_t indexSize = mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    item.lodCount = (uint32_t)objLoader.getLodCount();
+    for (size_t lod = 0; lod < MaxMeshLods; lod++) {
+        item.lodIndexOffset[lod] = 0;
+        item.lodIndexCount[lod] = 0;
+        if (lod < item.lodCount) {
+            item.lodIndexOffset[lod] = objLoader.getLodFaceOffset(lod) * 3 * indexSize;
+            item.lodIndexCount[lod] = objLoader.getLodFaceCount(lod) * 3;
+        }
+    }
+    return item;
+}
@@ -1,4 +1,8 @@
-#include "objloader.hpp"
+#include <memory>
+#include "mesh.hpp"
+#include "instancebuffer.hpp"
+#include "shaderprogram.hpp"
+#include "renderitem.hpp"
 #include <glm/glm.hpp>
 
 #ifndef OBJECT_HPP
@@ -6,11 +10,16 @@
 
 class Object {
 public:
-    Object(const std::string& filePath);
-    GLuint vao;
-    GLuint vbo;
-    GLuint ebo;
-    GLuint programID;
+    Object(const std::shared_ptr<Mesh>& mesh);
+
+    glm::mat4 getModelMatrix() const;
+
+    // Flattened copy of the draw state, see RenderItem
+    RenderItem createRenderItem() const;
+
+    std::shared_ptr<Mesh> mesh;     // Shared with every object using the same file
+    std::shared_ptr<InstanceBuffer> instances;  // Only set for instanced model entries
+    std::shared_ptr<ShaderProgram> program;
     std::string fragmentShader;
     std::string vertexShader;
     float locationX;
@@ -18,7 +27,7 @@ public:
     float locationZ;
     float angle;
     glm::vec3 color;
-    ObjLoader objLoader;
+    size_t node;    // Scene graph node, the transform above is local to its parent
 private:
 };
 
@@ -1,17 +1,34 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "vertex.hpp"
 #include "normal.hpp"
+#include "position.hpp"
 #include "face.hpp"
+#include "bounds.hpp"
+#include "mappedfile.hpp"
+#include "meshbin.hpp"
+#include "meshoptimizer.hpp"
+#include "quantization.hpp"
+#include "meshsimplifier.hpp"
 
 #include "objloader.hpp"
 
-ObjLoader::ObjLoader(const std::string& filePath) {
-    loadObj(filePath);
+ObjLoader::ObjLoader(const std::string& filePath, const ObjLoadOptions& options)
+    : released(false), releasedVertexCount(0), releasedFaceCount(0) {
+    Bounds empty = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+    bounds = empty;
+    vertexFormat = options.vertexFormat;
+    loadObj(filePath, options);
+
+    // Built here rather than at upload so loader threads do the simplifying
+    if (options.retention == MeshRetentionCollision) {
+        buildCollisionMesh(options.collisionRatio);
+    }
 }
 
 const std::vector<Vertex>& ObjLoader::getVertices() const {
@@ -26,53 +43,776 @@ const std::vector<Face>& ObjLoader::getFaces() const {
     return faces;
 }
 
-void ObjLoader::loadObj(const std::string& filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
+const void* ObjLoader::getVertexData() const {
+    if (released) {
+        return nullptr;
+    }
+    if (cache) {
+        const MeshBinHeader* header = (const MeshBinHeader*)cache->getData();
+        return cache->getData() + header->vertexOffset;
+    }
+    if (vertexFormat == VertexFormatQuantized) {
+        return packedVertices.data();
+    }
+    return vertices.data();
+}
+
+size_t ObjLoader::getVertexCount() const {
+    if (released) {
+        return releasedVertexCount;
+    }
+    if (cache) {
+        return (size_t)((const MeshBinHeader*)cache->getData())->vertexCount;
+    }
+    return vertices.size();
+}
+
+VertexFormat ObjLoader::getVertexFormat() const {
+    return vertexFormat;
+}
+
+const void* ObjLoader::getIndexData() const {
+    if (released) {
+        return nullptr;
+    }
+    if (cache) {
+        const MeshBinHeader* header = (const MeshBinHeader*)cache->getData();
+        return cache->getData() + header->faceOffset;
+    }
+    if (getIndexSize() == sizeof(uint16_t)) {
+        return shortIndices.data();
+    }
+    return faces.data();
+}
+
+size_t ObjLoader::getIndexSize() const {
+    return indexSize(getVertexCount());
+}
+
+size_t ObjLoader::getFaceCount() const {
+    if (released) {
+        return releasedFaceCount;
+    }
+    if (cache) {
+        return (size_t)((const MeshBinHeader*)cache->getData())->faceCount;
+    }
+    return faces.size();
+}
+
+size_t ObjLoader::getLodCount() const {
+    return lodFaceCounts.size();
+}
+
+size_t ObjLoader::getLodFaceOffset(size_t lod) const {
+    size_t offset = 0;
+    for (size_t i = 0; i < lod && i < lodFaceCounts.size(); i++) {
+        offset += lodFaceCounts[i];
+    }
+    return offset;
+}
+
+size_t ObjLoader::getLodFaceCount(size_t lod) const {
+    return lod < lodFaceCounts.size() ? lodFaceCounts[lod] : 0;
+}
+
+const Bounds& ObjLoader::getBounds() const {
+    return bounds;
+}
+
+bool ObjLoader::isCached() const {
+    return (bool)cache;
+}
+
+void ObjLoader::buildCollisionMesh(float ratio) {
+    const void* data = getVertexData();
+    size_t vertexCount = getVertexCount();
+    if (!data || lodFaceCounts.empty()) {
+        return;
+    }
+
+    // Float vertices of LOD 0, decoded from whichever layout was loaded
+    std::vector<Vertex> source;
+    if (!vertices.empty()) {
+        source = vertices;
+    } else if (vertexFormat == VertexFormatQuantized) {
+        const PackedVertex* packed = (const PackedVertex*)data;
+        source.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            source[i] = unpackVertex(packed[i], bounds);
+        }
+    } else {
+        const Vertex* loaded = (const Vertex*)data;
+        source.assign(loaded, loaded + vertexCount);
+    }
+
+    // LOD 0 triangles, widened when the indices were loaded as 16 bits
+    std::vector<Face> full;
+    if (!faces.empty()) {
+        full.assign(faces.begin(), faces.begin() + lodFaceCounts[0]);
+    } else if (getIndexSize() == sizeof(uint16_t)) {
+        const uint16_t* indices = (const uint16_t*)getIndexData();
+        full.resize(lodFaceCounts[0]);
+        for (size_t i = 0; i < full.size(); i++) {
+            Face face = { indices[i * 3 + 0], indices[i * 3 + 1], indices[i * 3 + 2] };
+            full[i] = face;
+        }
+    } else {
+        const Face* loaded = (const Face*)getIndexData();
+        full.assign(loaded, loaded + lodFaceCounts[0]);
+    }
+    std::vector<Face> simplified = ratio < 1.0f ? simplifyMesh(source, full, (size_t)(full.size() * ratio)) : full;
+
+    // Keep only the positions the simplified triangles reference
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertexCount, unused);
+    collisionPositions.clear();
+    collisionFaces.clear();
+    collisionFaces.reserve(simplified.size());
+    for (const Face& face : simplified) {
+        const unsigned int corners[3] = { face.v1, face.v2, face.v3 };
+        unsigned int compact[3];
+        for (int c = 0; c < 3; c++) {
+            unsigned int index = corners[c];
+            if (remap[index] == unused) {
+                remap[index] = (unsigned int)collisionPositions.size();
+                Position position = { source[index].x, source[index].y, source[index].z };
+                collisionPositions.push_back(position);
+            }
+            compact[c] = remap[index];
+        }
+        Face collisionFace = { compact[0], compact[1], compact[2] };
+        collisionFaces.push_back(collisionFace);
+    }
+    std::vector<Position>(collisionPositions).swap(collisionPositions);
+}
+
+const std::vector<Position>& ObjLoader::getCollisionPositions() const {
+    return collisionPositions;
+}
+
+const std::vector<Face>& ObjLoader::getCollisionFaces() const {
+    return collisionFaces;
+}
+
+void ObjLoader::releaseData() {
+    if (released) {
+        return;
+    }
+    releasedVertexCount = getVertexCount();
+    releasedFaceCount = getFaceCount();
+    released = true;
+
+    // swap with empty vectors, clear() keeps the capacity
+    std::vector<Vertex>().swap(vertices);
+    std::vector<Normal>().swap(normals);
+    std::vector<Face>().swap(faces);
+    std::vector<PackedVertex>().swap(packedVertices);
+    std::vector<uint16_t>().swap(shortIndices);
+    cache.reset();
+}
+
+bool ObjLoader::isReleased() const {
+    return released;
+}
+
+size_t ObjLoader::getDataBytes() const {
+    size_t bytes = vertices.capacity() * sizeof(Vertex) + normals.capacity() * sizeof(Normal)
+        + faces.capacity() * sizeof(Face) + packedVertices.capacity() * sizeof(PackedVertex)
+        + shortIndices.capacity() * sizeof(uint16_t)
+        + collisionPositions.capacity() * sizeof(Position) + collisionFaces.capacity() * sizeof(Face);
+    if (cache) {
+        bytes += cache->getSize();
+    }
+    return bytes;
+}
+
+// Exact powers of ten representable in a double
+static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+static inline const char* nextLine(const char* p, const char* end) {
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    return eol ? eol + 1 : end;
+}
+
+// Parses a decimal float in place, e.g. "-1.25e-3". Returns the position
+// after the number, or p unchanged if no number starts there.
+static const char* parseFloat(const char* p, const char* end, float& out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool any = false;
+
+    while (p < end && isDigit(*p)) {
+        // Past 19 digits the mantissa would overflow, just track the scale
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa) digits++;
+        } else {
+            exponent++;
+        }
+        any = true;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && isDigit(*p)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+            any = true;
+            p++;
+        }
+    }
+    if (!any) {
+        return start;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool negativeExp = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negativeExp = *e == '-';
+            e++;
+        }
+        if (e < end && isDigit(*e)) {
+            int exp = 0;
+            while (e < end && isDigit(*e)) {
+                if (exp < 1000) exp = exp * 10 + (*e - '0');
+                e++;
+            }
+            exponent += negativeExp ? -exp : exp;
+            p = e;
+        }
+    }
+
+    double value = (double)mantissa;
+    while (exponent > 22) {
+        value *= 1e22;
+        exponent -= 22;
+    }
+    while (exponent < -22) {
+        value /= 1e22;
+        exponent += 22;
+    }
+    value = exponent >= 0 ? value * powersOf10[exponent] : value / powersOf10[-exponent];
+
+    out = (float)(negative ? -value : value);
+    return p;
+}
+
+// Parses a signed decimal integer in place. Returns p unchanged on failure.
+static const char* parseInt(const char* p, const char* end, int& out) {
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    if (p >= end || !isDigit(*p)) {
+        return start;
+    }
+    int value = 0;
+    while (p < end && isDigit(*p)) {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    out = negative ? -value : value;
+    return p;
+}
+
+// Parses one "v", "v/t", "v//n" or "v/t/n" face corner. Missing indices are 0.
+static const char* parseCorner(const char* p, const char* end, int& v, int& t, int& n) {
+    t = 0;
+    n = 0;
+    const char* q = parseInt(p, end, v);
+    if (q == p) {
+        return p;
+    }
+    if (q < end && *q == '/') {
+        q++;
+        q = parseInt(q, end, t);
+        if (q < end && *q == '/') {
+            q++;
+            q = parseInt(q, end, n);
+        }
+    }
+    return q;
+}
+
+// Below this much text per thread a worker is not worth starting, so small
+// files always parse on the calling thread
+static const size_t minChunkBytes = 4 << 20;
+
+static const unsigned char relativeVertex = 1;
+static const unsigned char relativeNormal = 2;
+static const unsigned char hasNormal = 4;
+
+// A face corner as written in the file. Positive indices are already 0-based
+// and absolute. Negative indices are made relative to the start of the chunk
+// and flagged, they are fixed up once the chunk offsets are known.
+struct ObjCorner {
+    int v;
+    int n;
+    unsigned char flags;
+};
+
+struct ObjTriangle {
+    ObjCorner corners[3];
+};
+
+// Everything parsed from one line aligned slice of the file
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    std::vector<Position> positions;
+    std::vector<Normal> normals;
+    std::vector<ObjTriangle> triangles;
+    size_t skippedFaces;
+};
+
+// OBJ file indices start from 1, but OpenGL indices start from 0. Negative
+// indices count back from the last element seen so far.
+static inline int localIndex(int index, size_t count, bool& relative) {
+    relative = index < 0;
+    return relative ? (int)count + index : index - 1;
+}
+
+static void parseChunk(ObjChunk& chunk) {
+    const char* begin = chunk.begin;
+    const char* end = chunk.end;
+
+    // Pre-scan the line types so every array is allocated exactly once
+    size_t vertexCount = 0, normalCount = 0, faceCount = 0;
+    for (const char* p = begin; p < end; p = nextLine(p, end)) {
+        p = skipSpaces(p, end);
+        if (end - p < 2) {
+            continue;
+        }
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            vertexCount++;
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            normalCount++;
+        } else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            faceCount++;
+        }
+    }
+    chunk.positions.reserve(vertexCount);
+    chunk.normals.reserve(normalCount);
+    chunk.triangles.reserve(faceCount);
+    chunk.skippedFaces = 0;
+
+    for (const char* p = begin; p < end; p = nextLine(p, end)) {
+        p = skipSpaces(p, end);
+        if (end - p < 2) {
+            continue;
+        }
+
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            Position position = { 0.0f, 0.0f, 0.0f };
+            p = skipSpaces(p + 2, end);
+            p = skipSpaces(parseFloat(p, end, position.x), end);
+            p = skipSpaces(parseFloat(p, end, position.y), end);
+            parseFloat(p, end, position.z);
+            chunk.positions.push_back(position);
+        }
+        else if (p[0] == 'v' && p[1] == 'n') {
+            Normal normal = { 0.0f, 0.0f, 0.0f };
+            p = skipSpaces(p + 2, end);
+            p = skipSpaces(parseFloat(p, end, normal.x), end);
+            p = skipSpaces(parseFloat(p, end, normal.y), end);
+            parseFloat(p, end, normal.z);
+            chunk.normals.push_back(normal);
+        }
+        else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            // Polygons with more than three corners are split into a fan
+            ObjTriangle triangle;
+            int cornerCount = 0;
+            p = skipSpaces(p + 2, end);
+            while (p < end && *p != '\n') {
+                int v, t, n;
+                const char* q = parseCorner(p, end, v, t, n);
+                if (q == p) {
+                    break;
+                }
+                p = skipSpaces(q, end);
+
+                ObjCorner corner;
+                bool relative;
+                corner.v = localIndex(v, chunk.positions.size(), relative);
+                corner.flags = relative ? relativeVertex : 0;
+                corner.n = 0;
+                if (n != 0) {
+                    corner.n = localIndex(n, chunk.normals.size(), relative);
+                    corner.flags |= hasNormal | (relative ? relativeNormal : 0);
+                }
+                if (v == 0) {
+                    // Index 0 does not exist, force the range check to fail
+                    corner.v = -1;
+                    corner.flags = 0;
+                }
+
+                if (cornerCount < 3) {
+                    triangle.corners[cornerCount++] = corner;
+                } else {
+                    triangle.corners[1] = triangle.corners[2];
+                    triangle.corners[2] = corner;
+                }
+                if (cornerCount == 3) {
+                    chunk.triangles.push_back(triangle);
+                }
+            }
+            if (cornerCount < 3) {
+                chunk.skippedFaces++;
+            }
+        }
+    }
+}
+
+// Open addressing map from a (position, normal) index pair to the index of
+// the welded vertex, with linear probing in a power of two table. Texture
+// coordinate indices are not part of the key since Vertex has no UVs.
+class VertexWelder {
+public:
+    explicit VertexWelder(size_t expected) : count(0) {
+        size_t capacity = 64;
+        while (capacity < expected * 2) {
+            capacity *= 2;
+        }
+        resize(capacity);
+    }
+
+    // Returns the vertex stored for key, or stores and returns index
+    unsigned int insert(uint64_t key, unsigned int index, bool& inserted) {
+        if ((count + 1) * 2 > keys.size()) {
+            resize(keys.size() * 2);
+        }
+        size_t slot = hash(key);
+        while (keys[slot] != emptyKey) {
+            if (keys[slot] == key) {
+                inserted = false;
+                return values[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = key;
+        values[slot] = index;
+        count++;
+        inserted = true;
+        return index;
+    }
+
+private:
+    static const uint64_t emptyKey = ~0ULL;
+
+    std::vector<uint64_t> keys;
+    std::vector<unsigned int> values;
+    size_t count;
+    size_t mask;
+    int shift;
+
+    size_t hash(uint64_t key) const {
+        return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> shift) & mask;
+    }
+
+    void resize(size_t capacity) {
+        std::vector<uint64_t> oldKeys(capacity, emptyKey);
+        std::vector<unsigned int> oldValues(capacity);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        mask = capacity - 1;
+        shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) {
+            shift--;
+        }
+
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] == emptyKey) {
+                continue;
+            }
+            size_t slot = hash(oldKeys[i]);
+            while (keys[slot] != emptyKey) {
+                slot = (slot + 1) & mask;
+            }
+            keys[slot] = oldKeys[i];
+            values[slot] = oldValues[i];
+        }
+    }
+};
+
+const uint64_t VertexWelder::emptyKey;
+
+// Splits [begin, end) into at most count slices that each end on a newline
+static std::vector<ObjChunk> splitChunks(const char* begin, const char* end, size_t count) {
+    std::vector<ObjChunk> chunks(count);
+    size_t size = end - begin;
+    const char* p = begin;
+    for (size_t i = 0; i < count; i++) {
+        const char* split = i + 1 == count ? end : nextLine(begin + size * (i + 1) / count, end);
+        if (split < p) {
+            split = p;
+        }
+        chunks[i].begin = p;
+        chunks[i].end = split;
+        p = split;
+    }
+    return chunks;
+}
+
+void ObjLoader::loadObj(const std::string& filePath, const ObjLoadOptions& options) {
+    MappedFile file;
+    if (!file.open(filePath)) {
         std::cerr << "Error opening file: " << filePath << std::endl;
         return;
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string type;
-        char junk;
-        iss >> type;
+    const char* begin = file.getData();
+    const char* end = begin + file.getSize();
+
+    // The sidecar has room for a fixed number of levels
+    std::vector<float> lodRatios = options.lodRatios;
+    if (lodRatios.size() + 1 > MaxMeshLods) {
+        lodRatios.resize(MaxMeshLods - 1);
+    }
+
+    uint64_t sourceHash = 0;
+    uint32_t cookFlags = options.optimize ? MeshBinCookOptimized : 0;
+    std::string cachePath = meshBinPath(filePath, vertexFormat, lodRatios);
+    if (options.useCache) {
+        sourceHash = hashBytes(begin, file.getSize());
 
-        if (type == "v") {
-            Vertex vertex;
-            iss >> vertex.x >> vertex.y >> vertex.z;
-            vertices.push_back(vertex);
+        // Keep the sidecar mapped, its arrays are uploaded straight from it
+        std::shared_ptr<MappedFile> sidecar(new MappedFile());
+        if (sidecar->open(cachePath)) {
+            const MeshBinHeader* header = validateMeshBin(*sidecar, file.getSize(), sourceHash, vertexFormat, cookFlags, lodRatios);
+            if (header) {
+                bounds = header->bounds;
+                lodFaceCounts.assign(header->lodFaceCounts, header->lodFaceCounts + header->lodCount);
+                cache = sidecar;
+                return;
+            }
+            std::cerr << "Mesh cache out of date: " << cachePath << std::endl;
         }
-        else if (type == "vn"){
-            Normal normal;
-            iss >> normal.x >> normal.y >> normal.z;
-            normals.push_back(normal);
+    }
+
+    parseObj(begin, end, options, filePath);
+    computeBounds();
+    lodFaceCounts.assign(1, faces.size());
+
+    if (options.optimize) {
+        VertexCacheStats before = analyzeVertexCache(faces.data(), faces.size(), vertices.size());
+        std::vector<Face> optimized = faces;
+        optimizeVertexCache(optimized, vertices.size());
+
+        // Some exporters already write strips in a good order, keep that
+        VertexCacheStats after = analyzeVertexCache(optimized.data(), optimized.size(), vertices.size());
+        if (after.acmr < before.acmr) {
+            faces.swap(optimized);
+        } else {
+            after = before;
         }
-        else if (type == "f") {
-            Face face;
-            int n1, n2, n3;
+        optimizeVertexFetch(vertices, faces);
 
-            iss >> face.v1 >> junk >> junk >> n1 >> face.v2 >> junk >> junk >> n2 >> face.v3 >> junk >> junk >> n3;
-            
-            // OBJ file indices start from 1, but OpenGL indices start from 0
-            vertices[face.v1-1].nX = normals[n1-1].x;
-            vertices[face.v1-1].nY = normals[n1-1].y;
-            vertices[face.v1-1].nZ = normals[n1-1].z;
+        std::cerr << "Optimized " << filePath << ": ACMR " << before.acmr << " -> " << after.acmr
+                  << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+    }
 
-            vertices[face.v2-1].nX = normals[n2-1].x;
-            vertices[face.v2-1].nY = normals[n2-1].y;
-            vertices[face.v2-1].nZ = normals[n2-1].z;
+    std::vector<float> lodLevels;
+    if (!lodRatios.empty()) {
+        lodLevels = generateLods(lodRatios, filePath);
+    }
 
-            vertices[face.v3-1].nX = normals[n3-1].x;
-            vertices[face.v3-1].nY = normals[n3-1].y;
-            vertices[face.v3-1].nZ = normals[n3-1].z;
+    if (vertexFormat == VertexFormatQuantized) {
+        packVertices(vertices, bounds, packedVertices);
+        size_t floatBytes = vertices.size() * sizeof(Vertex);
+        size_t packedBytes = packedVertices.size() * sizeof(PackedVertex);
+        std::cerr << "Quantized " << filePath << ": " << floatBytes / 1024 << " KB -> " << packedBytes / 1024
+                  << " KB (" << (floatBytes - packedBytes) / 1024 << " KB saved)" << std::endl;
+    }
 
-            face.v1--; face.v2--; face.v3--;
+    // Narrow once here so neither the sidecar nor the upload has to
+    if (indexSize(vertices.size()) == sizeof(uint16_t)) {
+        shortIndices.resize(faces.size() * 3);
+        for (size_t i = 0; i < faces.size(); i++) {
+            shortIndices[i * 3 + 0] = (uint16_t)faces[i].v1;
+            shortIndices[i * 3 + 1] = (uint16_t)faces[i].v2;
+            shortIndices[i * 3 + 2] = (uint16_t)faces[i].v3;
+        }
+    }
+
+    if (options.useCache) {
+        writeMeshBin(cachePath, file.getSize(), sourceHash, cookFlags, bounds,
+            vertexFormat, getVertexData(), vertices.size(), getIndexData(), lodLevels, lodFaceCounts);
+    }
+}
+
+std::vector<float> ObjLoader::generateLods(const std::vector<float>& ratios, const std::string& filePath) {
+    // Every level is simplified from the full mesh, so errors do not add up
+    std::vector<Face> full(faces.begin(), faces.begin() + lodFaceCounts[0]);
+    std::vector<float> levels;
+    size_t dropped = 0;
+    std::cerr << "LODs " << filePath << ": " << full.size();
+    for (size_t i = 0; i < ratios.size(); i++) {
+        std::vector<Face> lod = simplifyMesh(vertices, full, (size_t)(full.size() * ratios[i]));
+
+        // A level no smaller than the one before only costs memory, and
+        // selecting it would draw the same triangles at a lower LOD
+        if (lod.empty() || lod.size() >= lodFaceCounts.back()) {
+            dropped++;
+            continue;
+        }
+        optimizeVertexCache(lod, vertices.size());
+        faces.insert(faces.end(), lod.begin(), lod.end());
+        lodFaceCounts.push_back(lod.size());
+        levels.push_back(ratios[i]);
+        std::cerr << " -> " << lod.size();
+    }
+    std::cerr << " triangles";
+    if (dropped > 0) {
+        std::cerr << " (dropped " << dropped << " that did not reduce)";
+    }
+    std::cerr << std::endl;
+    return levels;
+}
+
+void ObjLoader::computeBounds() {
+    if (vertices.empty()) {
+        return;
+    }
+    Bounds box = { { vertices[0].x, vertices[0].y, vertices[0].z }, { vertices[0].x, vertices[0].y, vertices[0].z } };
+    for (const Vertex& vertex : vertices) {
+        const float position[3] = { vertex.x, vertex.y, vertex.z };
+        for (int i = 0; i < 3; i++) {
+            if (position[i] < box.min[i]) box.min[i] = position[i];
+            if (position[i] > box.max[i]) box.max[i] = position[i];
+        }
+    }
+    bounds = box;
+}
+
+void ObjLoader::parseObj(const char* begin, const char* end, const ObjLoadOptions& options, const std::string& filePath) {
+    size_t fileSize = end - begin;
+    size_t threadCount = 1;
+    if (options.parallel) {
+        threadCount = options.threads ? options.threads : std::thread::hardware_concurrency();
+        size_t maxChunks = fileSize / minChunkBytes;
+        if (threadCount > maxChunks) threadCount = maxChunks;
+        if (threadCount < 1) threadCount = 1;
+    }
+
+    // Parse every chunk into its own arrays, the calling thread takes the first
+    std::vector<ObjChunk> chunks = splitChunks(begin, end, threadCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); i++) {
+        workers.push_back(std::thread(parseChunk, std::ref(chunks[i])));
+    }
+    parseChunk(chunks[0]);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Prefix sums give each chunk its offset in the merged arrays
+    std::vector<size_t> positionOffsets(chunks.size()), normalOffsets(chunks.size());
+    size_t positionCount = 0, normalCount = 0, triangleCount = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        positionOffsets[i] = positionCount;
+        normalOffsets[i] = normalCount;
+        positionCount += chunks[i].positions.size();
+        normalCount += chunks[i].normals.size();
+        triangleCount += chunks[i].triangles.size();
+    }
+
+    std::vector<Position> positions;
+    positions.reserve(positionCount);
+    normals.reserve(normalCount);
+    faces.reserve(triangleCount);
+    for (ObjChunk& chunk : chunks) {
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        std::vector<Position>().swap(chunk.positions);
+        std::vector<Normal>().swap(chunk.normals);
+    }
+
+    // Weld every distinct (position, normal) pair into one vertex, in the
+    // order the faces first reference them
+    VertexWelder welder(positionCount);
+    vertices.reserve(positionCount);
+    size_t skippedFaces = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        long long positionOffset = (long long)positionOffsets[i];
+        long long normalOffset = (long long)normalOffsets[i];
+        for (const ObjTriangle& triangle : chunks[i].triangles) {
+            long long v[3], n[3];
+            bool valid = true;
+            for (int c = 0; c < 3; c++) {
+                const ObjCorner& corner = triangle.corners[c];
+                v[c] = corner.v + ((corner.flags & relativeVertex) ? positionOffset : 0);
+                if (v[c] < 0 || v[c] >= (long long)positionCount) {
+                    valid = false;
+                }
+
+                // A missing or out of range normal welds to a zero normal
+                n[c] = -1;
+                if (corner.flags & hasNormal) {
+                    long long normal = corner.n + ((corner.flags & relativeNormal) ? normalOffset : 0);
+                    if (normal >= 0 && normal < (long long)normalCount) {
+                        n[c] = normal;
+                    }
+                }
+            }
+            if (!valid) {
+                skippedFaces++;
+                continue;
+            }
+
+            unsigned int index[3];
+            for (int c = 0; c < 3; c++) {
+                uint64_t key = ((uint64_t)v[c] << 32) | (uint64_t)(n[c] + 1);
+                bool inserted;
+                index[c] = welder.insert(key, (unsigned int)vertices.size(), inserted);
+                if (inserted) {
+                    const Position& position = positions[v[c]];
+                    Vertex vertex = { position.x, position.y, position.z, 0.0f, 0.0f, 0.0f };
+                    if (n[c] >= 0) {
+                        vertex.nX = normals[n[c]].x;
+                        vertex.nY = normals[n[c]].y;
+                        vertex.nZ = normals[n[c]].z;
+                    }
+                    vertices.push_back(vertex);
+                }
+            }
+
+            Face face = { index[0], index[1], index[2] };
             faces.push_back(face);
         }
+        skippedFaces += chunks[i].skippedFaces;
     }
 
-    file.close();
-}
\ No newline at end of file
+    std::cerr << "Welded " << filePath << ": " << positionCount << " positions, "
+              << faces.size() * 3 << " corners -> " << vertices.size() << " vertices" << std::endl;
+
+    if (skippedFaces > 0) {
+        std::cerr << "Skipped " << skippedFaces << " invalid faces in: " << filePath << std::endl;
+    }
+}
@@ -1,27 +1,114 @@
+#include <memory>
 #include <vector>
 #include "vertex.hpp"
 #include "normal.hpp"
 #include "face.hpp"
+#include "bounds.hpp"
+#include "position.hpp"
 
 #ifndef OBJLOADER_HPP
 #define OBJLOADER_HPP
 
+class MappedFile;
+
+// CPU data a Mesh keeps once its buffers are uploaded
+enum MeshRetention {
+    MeshRetentionAll,           // Every array, as loaded
+    MeshRetentionBounds,        // Bounds and counts only
+    MeshRetentionCollision      // Bounds, counts and a decimated collision copy
+};
+
+struct ObjLoadOptions {
+    // Split large files across worker threads. The result is identical to
+    // the serial parse, small files always parse on the calling thread.
+    bool parallel;
+    // Number of worker threads, 0 uses every hardware thread
+    unsigned int threads;
+    // Load from the cooked .meshbin sidecar when it matches the source,
+    // otherwise parse the OBJ file and write a new sidecar
+    bool useCache;
+    // Reorder triangles and vertices for the GPU vertex cache and fetch
+    bool optimize;
+    // Layout of the upload arrays, the float arrays are always kept as well
+    VertexFormat vertexFormat;
+    // Triangle ratios of the simplified levels of detail to generate, e.g.
+    // { 0.5, 0.25, 0.1 }. LOD 0 is always the full mesh.
+    std::vector<float> lodRatios;
+    // Applied by Mesh after upload, collisionRatio is the triangle ratio of
+    // the MeshRetentionCollision copy
+    MeshRetention retention;
+    float collisionRatio;
+
+    ObjLoadOptions() : parallel(true), threads(0), useCache(true), optimize(true), vertexFormat(VertexFormatFloat),
+        retention(MeshRetentionAll), collisionRatio(0.25f) {}
+};
+
 class ObjLoader {
 public:
-    ObjLoader(const std::string& filePath);
+    ObjLoader(const std::string& filePath, const ObjLoadOptions& options = ObjLoadOptions());
 
+    // Parsed arrays, empty when the mesh was loaded from its sidecar. faces
+    // holds LOD 0 followed by the simplified levels.
     const std::vector<Vertex>& getVertices() const;
 
     const std::vector<Normal>& getVertexNormals() const;
     
     const std::vector<Face>& getFaces() const;
 
+    // Upload ready arrays in getVertexFormat() layout and getIndexSize()
+    // wide indices, these point into the sidecar mapping when cached
+    const void* getVertexData() const;
+    size_t getVertexCount() const;
+    VertexFormat getVertexFormat() const;
+    const void* getIndexData() const;
+    size_t getIndexSize() const;
+    size_t getFaceCount() const;
+
+    // Every LOD lives in the index array back to back, LOD 0 first. Levels
+    // that did not reduce the previous one are left out, so there can be
+    // fewer than lodRatios asked for.
+    size_t getLodCount() const;
+    size_t getLodFaceOffset(size_t lod) const;
+    size_t getLodFaceCount(size_t lod) const;
+
+    const Bounds& getBounds() const;
+    bool isCached() const;
+
+    // Simplified copy of LOD 0 for collision queries, with only the
+    // positions its triangles use. Built on load for MeshRetentionCollision.
+    void buildCollisionMesh(float ratio);
+    const std::vector<Position>& getCollisionPositions() const;
+    const std::vector<Face>& getCollisionFaces() const;
+
+    // Frees the vertex and face arrays and unmaps the sidecar. Counts,
+    // bounds, LOD ranges and the collision copy stay valid, the data
+    // pointers become null.
+    void releaseData();
+    bool isReleased() const;
+
+    // CPU bytes held by the arrays, the sidecar mapping and the collision copy
+    size_t getDataBytes() const;
+
 private:
     std::vector<Vertex> vertices;
     std::vector<Normal> normals;
     std::vector<Face> faces;
+    std::vector<PackedVertex> packedVertices;
+    std::vector<uint16_t> shortIndices;
+    std::vector<size_t> lodFaceCounts;
+    std::vector<Position> collisionPositions;
+    std::vector<Face> collisionFaces;
+    bool released;
+    size_t releasedVertexCount;
+    size_t releasedFaceCount;
+    VertexFormat vertexFormat;
+    Bounds bounds;
+    std::shared_ptr<MappedFile> cache;
 
-    void loadObj(const std::string& filePath);
+    void loadObj(const std::string& filePath, const ObjLoadOptions& options);
+    void parseObj(const char* begin, const char* end, const ObjLoadOptions& options, const std::string& filePath);
+    void computeBounds();
+    std::vector<float> generateLods(const std::vector<float>& ratios, const std::string& filePath);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,8 @@
+#ifndef POSITION_HPP
+#define POSITION_HPP
+
+struct Position {
+    float x, y, z;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mappedfile.hpp"
+#include "meshbin.hpp"
+
+#include "programcache.hpp"
+
+static const char ProgramBinMagic[8] = { 'G', 'L', 'P', 'R', 'O', 'G', 'B', 'N' };
+
+static std::string glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? std::string((const char*)value) : std::string();
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+    : _directory(directory), _checked(false), _supported(false), _rejects(0) {
+}
+
+bool ProgramBinaryCache::isSupported() {
+    if (_checked) {
+        return _supported;
+    }
+    _checked = true;
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        std::cerr << "Program binary cache disabled: glGetProgramBinary is not available" << std::endl;
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        std::cerr << "Program binary cache disabled: the driver has no binary formats" << std::endl;
+        return false;
+    }
+    if (mkdir(_directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Program binary cache disabled: cannot create " << _directory << std::endl;
+        return false;
+    }
+    _driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+    _supported = true;
+    return true;
+}
+
+uint64_t ProgramBinaryCache::key(const std::string& vertexCode, const std::string& fragmentCode) {
+    isSupported();
+    std::string data = _driver;
+    data += '\0';
+    data += vertexCode;
+    data += '\0';
+    data += fragmentCode;
+    return hashBytes(data.data(), data.size());
+}
+
+std::string ProgramBinaryCache::filePath(uint64_t key) const {
+    std::ostringstream path;
+    path << _directory << "/" << std::hex << key << ".glprog";
+    return path.str();
+}
+
+GLuint ProgramBinaryCache::load(uint64_t key) {
+    if (!isSupported()) {
+        return 0;
+    }
+    std::string path = filePath(key);
+    MappedFile file;
+    if (!file.open(path)) {
+        return 0;
+    }
+
+    ProgramBinHeader header;
+    bool valid = file.getSize() >= sizeof(header);
+    if (valid) {
+        memcpy(&header, file.getData(), sizeof(header));
+        valid = memcmp(header.magic, ProgramBinMagic, sizeof(header.magic)) == 0 && header.version == ProgramBinVersion
+            && header.keyHash == key && header.binarySize == file.getSize() - sizeof(header);
+    }
+    if (!valid) {
+        std::cerr << "Invalid program binary: " << path << std::endl;
+        file.close();
+        remove(path.c_str());
+        return 0;
+    }
+
+    GLuint programID = glCreateProgram();
+    glProgramBinary(programID, header.binaryFormat, file.getData() + sizeof(header), (GLsizei)header.binarySize);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        // Usually a driver update the version string did not reflect
+        std::cerr << "Driver rejected program binary: " << path << std::endl;
+        glDeleteProgram(programID);
+        file.close();
+        remove(path.c_str());
+        _rejects++;
+        return 0;
+    }
+    return programID;
+}
+
+bool ProgramBinaryCache::store(uint64_t key, GLuint programID) {
+    if (!isSupported()) {
+        return false;
+    }
+    GLint linked = GL_FALSE;
+    GLint length = 0;
+    glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (linked != GL_TRUE || length <= 0) {
+        return false;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(programID, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return false;
+    }
+
+    ProgramBinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ProgramBinMagic, sizeof(header.magic));
+    header.version = ProgramBinVersion;
+    header.binaryFormat = format;
+    header.keyHash = key;
+    header.binarySize = (uint64_t)written;
+
+    // Write to a temporary file and rename it so readers never see half a file
+    static std::atomic<unsigned int> writeCount(0);
+    std::string path = filePath(key);
+    std::string tempPath = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(writeCount++);
+    FILE* file = fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error writing program binary: " << tempPath << std::endl;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(binary.data(), 1, written, file) == (size_t)written;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error writing program binary: " << path << std::endl;
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+size_t ProgramBinaryCache::getRejectCount() const {
+    return _rejects;
+}
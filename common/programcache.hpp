@@ -0,0 +1,52 @@
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+// Linked program binary stored by ProgramBinaryCache, one file per key.
+// The header is followed by binarySize bytes in the driver's format.
+static const uint32_t ProgramBinVersion = 1;
+
+struct ProgramBinHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t binaryFormat;      // GLenum from glGetProgramBinary
+    uint64_t keyHash;
+    uint64_t binarySize;
+};
+
+// Persistent cache of linked programs read back with glGetProgramBinary.
+// Keys hash the final shader sources, defines included, with the GL
+// vendor, renderer and version strings, so a driver update or another GPU
+// misses instead of loading a stale binary. Drivers may still reject a
+// binary, load() then deletes the file and the caller compiles from source.
+class ProgramBinaryCache {
+public:
+    ProgramBinaryCache(const std::string& directory);
+
+    // Needs a current context, GL 4.1 or ARB_get_program_binary and at
+    // least one binary format
+    bool isSupported();
+
+    uint64_t key(const std::string& vertexCode, const std::string& fragmentCode);
+
+    // Linked program, or 0 if there is no usable binary for the key
+    GLuint load(uint64_t key);
+    // Only succeeds for programs linked with the retrievable hint
+    bool store(uint64_t key, GLuint programID);
+
+    size_t getRejectCount() const;
+
+private:
+    std::string _directory;
+    std::string _driver;
+    bool _checked;
+    bool _supported;
+    size_t _rejects;
+
+    std::string filePath(uint64_t key) const;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "mappedfile.hpp"
+#include "programcache.hpp"
+#include "shader.hpp"
+#include "shaderprogram.hpp"
+
+#include "programregistry.hpp"
+
+ProgramRegistry::ProgramRegistry(const std::string& binaryCacheDirectory)
+    : _binaries(binaryCacheDirectory), _hits(0), _compiles(0), _failures(0), _compileSeconds(0.0), _binaryLoads(0),
+      _binaryLoadSeconds(0.0) {
+}
+
+std::string ProgramRegistry::key(const std::string& vertexPath, const std::string& fragmentPath,
+                                 const std::vector<std::string>& defines) {
+    std::vector<std::string> sorted(defines);
+    std::sort(sorted.begin(), sorted.end());
+    std::string key = canonicalPath(vertexPath) + "|" + canonicalPath(fragmentPath) + "|defines";
+    for (const std::string& define : sorted) {
+        key += " " + define;
+    }
+    return key;
+}
+
+std::shared_ptr<ShaderProgram> ProgramRegistry::acquire(const std::string& vertexPath, const std::string& fragmentPath,
+                                                        const std::vector<std::string>& defines) {
+    std::string programKey = key(vertexPath, fragmentPath, defines);
+    std::map<std::string, std::weak_ptr<ShaderProgram>>::iterator it = _programs.find(programKey);
+    if (it != _programs.end()) {
+        std::shared_ptr<ShaderProgram> program = it->second.lock();
+        if (program) {
+            _hits++;
+            return program;
+        }
+        _programs.erase(it);
+    }
+
+    std::string vertexCode;
+    std::string fragmentCode;
+    if (!ReadShaderSources(vertexPath.c_str(), fragmentPath.c_str(), defines, vertexCode, fragmentCode)) {
+        return std::shared_ptr<ShaderProgram>();
+    }
+
+    // Sources the binary cache has seen skip compiling and linking
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t binaryKey = _binaries.key(vertexCode, fragmentCode);
+    GLuint programID = _binaries.load(binaryKey);
+    std::shared_ptr<ShaderProgram> program;
+    if (programID != 0) {
+        program = std::make_shared<ShaderProgram>(programID);
+        _binaryLoadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        _binaryLoads++;
+    } else {
+        // Only submitted here, update() picks the program up once linked
+        ShaderJob job;
+        if (_pending.empty()) {
+            _pendingSince = start;
+        }
+        if (!SubmitShaders(vertexPath.c_str(), fragmentPath.c_str(), vertexCode, fragmentCode, _binaries.isSupported(), job)) {
+            return std::shared_ptr<ShaderProgram>();
+        }
+        program = std::make_shared<ShaderProgram>(job);
+        PendingProgram pending = { program, binaryKey };
+        _pending.push_back(pending);
+        _compiles++;
+    }
+
+    _programs[programKey] = program;
+    return program;
+}
+
+void ProgramRegistry::update() {
+    completePending(false);
+}
+
+void ProgramRegistry::finish() {
+    completePending(true);
+}
+
+void ProgramRegistry::completePending(bool wait) {
+    if (_pending.empty()) {
+        return;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < _pending.size(); i++) {
+        std::shared_ptr<ShaderProgram> program = _pending[i].program.lock();
+        if (program && !(wait ? program->finish() : program->poll()) && !program->hasFailed()) {
+            _pending[kept++] = _pending[i];
+            continue;
+        }
+        // Dropped, linked or failed
+        if (program && program->isReady()) {
+            _binaries.store(_pending[i].binaryKey, program->getID());
+        } else if (program) {
+            _failures++;
+        }
+    }
+    _pending.resize(kept);
+
+    if (_pending.empty()) {
+        _compileSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - _pendingSince).count();
+        std::cerr << "Programs: " << _compiles << " compiled in " << _compileSeconds * 1000.0 << " ms, " << _failures
+                  << " failed" << std::endl;
+    }
+}
+
+size_t ProgramRegistry::getPendingCount() const {
+    return _pending.size();
+}
+
+size_t ProgramRegistry::getFailureCount() const {
+    return _failures;
+}
+
+size_t ProgramRegistry::getHits() const {
+    return _hits;
+}
+
+size_t ProgramRegistry::getCompileCount() const {
+    return _compiles;
+}
+
+double ProgramRegistry::getCompileSeconds() const {
+    return _compileSeconds;
+}
+
+size_t ProgramRegistry::getProgramCount() const {
+    size_t count = 0;
+    for (const auto& entry : _programs) {
+        if (!entry.second.expired()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t ProgramRegistry::getBinaryLoadCount() const {
+    return _binaryLoads;
+}
+
+double ProgramRegistry::getBinaryLoadSeconds() const {
+    return _binaryLoadSeconds;
+}
+
+size_t ProgramRegistry::getBinaryRejectCount() const {
+    return _binaries.getRejectCount();
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "programcache.hpp"
+#include "shaderprogram.hpp"
+
+#ifndef PROGRAMREGISTRY_HPP
+#define PROGRAMREGISTRY_HPP
+
+// Hands out one shared ShaderProgram per vertex/fragment shader pair and
+// define set, so objects drawn with the same shaders compile and link them
+// once. Like MeshRegistry it only holds weak references, a program is
+// deleted when the last Object using it goes away. Programs compiled
+// from source are saved to the binary cache, later runs load them from
+// there unless the sources or the driver changed.
+//
+// Compiles are only submitted by acquire(), so all programs of a level can
+// compile in parallel. Their status is checked by update() or finish(),
+// until then the returned program is not ready.
+class ProgramRegistry {
+public:
+    ProgramRegistry(const std::string& binaryCacheDirectory = "program_cache");
+
+    // Null if the shader files could not be read
+    std::shared_ptr<ShaderProgram> acquire(const std::string& vertexPath, const std::string& fragmentPath,
+                                           const std::vector<std::string>& defines = std::vector<std::string>());
+
+    // Canonical paths plus the sorted defines, so the define order and the
+    // spelling of the paths do not split the cache
+    static std::string key(const std::string& vertexPath, const std::string& fragmentPath,
+                           const std::vector<std::string>& defines);
+
+    // Picks up programs that finished linking, without blocking when the
+    // driver supports KHR_parallel_shader_compile. Call once per frame.
+    void update();
+    // Waits for every submitted program
+    void finish();
+    size_t getPendingCount() const;
+    size_t getFailureCount() const;
+
+    size_t getHits() const;
+    // Programs submitted for compiling, still pending ones included
+    size_t getCompileCount() const;
+    // Wall time with compiles in flight, from the first submission of a
+    // batch until its last program linked, reflection included
+    double getCompileSeconds() const;
+    // Programs loaded from the binary cache and the time that took,
+    // reflection included, and binaries the driver rejected
+    size_t getBinaryLoadCount() const;
+    double getBinaryLoadSeconds() const;
+    size_t getBinaryRejectCount() const;
+
+    // Programs still referenced
+    size_t getProgramCount() const;
+
+private:
+    // Submitted programs not linked yet, stored in the binary cache once
+    // they are
+    struct PendingProgram {
+        std::weak_ptr<ShaderProgram> program;
+        uint64_t binaryKey;
+    };
+
+    std::map<std::string, std::weak_ptr<ShaderProgram>> _programs;
+    ProgramBinaryCache _binaries;
+    std::vector<PendingProgram> _pending;
+    std::chrono::steady_clock::time_point _pendingSince;
+    size_t _hits;
+    size_t _compiles;
+    size_t _failures;
+    double _compileSeconds;
+    size_t _binaryLoads;
+    double _binaryLoadSeconds;
+
+    void completePending(bool wait);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include <cmath>
+#include <vector>
+
+#include "vertex.hpp"
+#include "bounds.hpp"
+
+#include "quantization.hpp"
+
+static inline uint16_t quantizeUnorm(float value, float minimum, float extent) {
+    if (extent <= 0.0f) {
+        return 0;
+    }
+    float t = (value - minimum) / extent;
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    return (uint16_t)(t * 65535.0f + 0.5f);
+}
+
+static inline int16_t quantizeSnorm(float value) {
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return (int16_t)lrintf(value * 32767.0f);
+}
+
+static inline float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+PackedVertex packVertex(const Vertex& vertex, const Bounds& bounds) {
+    PackedVertex packed;
+    packed.x = quantizeUnorm(vertex.x, bounds.min[0], bounds.max[0] - bounds.min[0]);
+    packed.y = quantizeUnorm(vertex.y, bounds.min[1], bounds.max[1] - bounds.min[1]);
+    packed.z = quantizeUnorm(vertex.z, bounds.min[2], bounds.max[2] - bounds.min[2]);
+    packed.padding = 0;
+
+    // Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower
+    // half over the diagonals so the whole sphere maps onto [-1, 1]^2
+    float length = fabsf(vertex.nX) + fabsf(vertex.nY) + fabsf(vertex.nZ);
+    float u = 0.0f, v = 0.0f;
+    if (length > 0.0f) {
+        u = vertex.nX / length;
+        v = vertex.nY / length;
+        if (vertex.nZ < 0.0f) {
+            float foldedU = (1.0f - fabsf(v)) * signNotZero(u);
+            float foldedV = (1.0f - fabsf(u)) * signNotZero(v);
+            u = foldedU;
+            v = foldedV;
+        }
+    }
+    packed.nU = quantizeSnorm(u);
+    packed.nV = quantizeSnorm(v);
+    return packed;
+}
+
+Vertex unpackVertex(const PackedVertex& packed, const Bounds& bounds) {
+    Vertex vertex;
+    vertex.x = bounds.min[0] + (packed.x / 65535.0f) * (bounds.max[0] - bounds.min[0]);
+    vertex.y = bounds.min[1] + (packed.y / 65535.0f) * (bounds.max[1] - bounds.min[1]);
+    vertex.z = bounds.min[2] + (packed.z / 65535.0f) * (bounds.max[2] - bounds.min[2]);
+
+    float u = packed.nU / 32767.0f;
+    float v = packed.nV / 32767.0f;
+    float x = u, y = v, z = 1.0f - fabsf(u) - fabsf(v);
+    float t = z < 0.0f ? -z : 0.0f;
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = sqrtf(x * x + y * y + z * z);
+    vertex.nX = x / length;
+    vertex.nY = y / length;
+    vertex.nZ = z / length;
+    return vertex;
+}
+
+void packVertices(const std::vector<Vertex>& vertices, const Bounds& bounds, std::vector<PackedVertex>& packed) {
+    packed.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        packed[i] = packVertex(vertices[i], bounds);
+    }
+}
@@ -0,0 +1,17 @@
+#include <vector>
+#include "vertex.hpp"
+#include "bounds.hpp"
+
+#ifndef QUANTIZATION_HPP
+#define QUANTIZATION_HPP
+
+// Quantizes positions against bounds and octahedral encodes the normals.
+// SimpleVertexShader.glsl decodes these when QUANTIZED_VERTICES is defined.
+PackedVertex packVertex(const Vertex& vertex, const Bounds& bounds);
+
+// CPU reference decode, matches the shader
+Vertex unpackVertex(const PackedVertex& packed, const Bounds& bounds);
+
+void packVertices(const std::vector<Vertex>& vertices, const Bounds& bounds, std::vector<PackedVertex>& packed);
+
+#endif
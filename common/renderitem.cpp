@@ -0,0 +1,11 @@
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "lodselection.hpp"
+
+#include "renderitem.hpp"
+
+size_t selectLod(const RenderItem& item, const glm::vec3& cameraPosition, float projectionScale) {
+    glm::vec3 center = glm::vec3(item.model * glm::vec4(item.boundsCenter, 1.0f));
+    return selectLod(center, item.boundsRadius, item.lodCount, cameraPosition, projectionScale);
+}
@@ -0,0 +1,47 @@
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <glm/glm.hpp>
+#include "meshbin.hpp"
+#include "shaderprogram.hpp"
+
+#ifndef RENDERITEM_HPP
+#define RENDERITEM_HPP
+
+// Everything the draw loop reads for one object, flattened into a plain
+// struct so the loop never touches Object, Mesh or ObjLoader. Items are
+// built once at load time and only their transform and color are
+// refreshed each frame.
+struct RenderItem {
+    glm::mat4 model;
+    glm::mat3 normalMatrix;     // Inverse transpose of model's upper 3x3
+    glm::vec3 color;
+
+    // Bounding sphere in mesh space, for picking a level of detail
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+
+    // Quantized positions are unorm16 against the mesh bounds
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+    bool quantized;
+
+    GLuint vao;
+    GLuint programID;
+    const ProgramUniforms* uniforms;    // Owned by the object's ShaderProgram
+    GLenum indexType;   // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t instanceCount; // 0 for a plain draw, else glDrawElementsInstanced
+
+    // Byte offset and index count of each level in the element buffer
+    uint32_t lodCount;
+    size_t lodIndexOffset[MaxMeshLods];
+    size_t lodIndexCount[MaxMeshLods];
+};
+
+static_assert(std::is_trivially_copyable<RenderItem>::value, "RenderItem must stay a plain copyable struct");
+
+// Picks a level of detail from the bounding sphere's projected size, see
+// lodselection.hpp
+size_t selectLod(const RenderItem& item, const glm::vec3& cameraPosition, float projectionScale);
+
+#endif
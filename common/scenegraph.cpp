@@ -0,0 +1,206 @@
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "scenegraph.hpp"
+
+const size_t SceneGraph::NoParent;
+
+SceneGraph::SceneGraph() : _dirtyCount(0), _orderValid(true) {
+}
+
+size_t SceneGraph::addNode(float x, float y, float z, float angle, size_t parent) {
+    size_t node = _parents.size();
+    _parents.push_back(parent);
+    _transforms.resize(node + 1);
+    _transforms.set(node, x, y, z, angle);
+    _locals.push_back(glm::mat4(1.0f));
+    _localNormals.resize(_localNormals.size() + NormalMatrixFloats, 0.0f);
+    _worlds.push_back(glm::mat4(1.0f));
+    _normals.push_back(glm::mat3(1.0f));
+    _dirty.push_back(1);
+    _changed.push_back(0);
+    _dirtyCount++;
+    _orderValid = false;
+    return node;
+}
+
+void SceneGraph::setParent(size_t node, size_t parent) {
+    _parents[node] = parent;
+    _orderValid = false;
+    if (!_dirty[node]) {
+        _dirty[node] = 1;
+        _dirtyCount++;
+    }
+}
+
+void SceneGraph::setLocalTransform(size_t node, float x, float y, float z, float angle) {
+    _transforms.set(node, x, y, z, angle);
+    if (!_dirty[node]) {
+        _dirty[node] = 1;
+        _dirtyCount++;
+    }
+}
+
+void SceneGraph::reserve(size_t count) {
+    _parents.reserve(count);
+    _locals.reserve(count);
+    _localNormals.reserve(count * NormalMatrixFloats);
+    _worlds.reserve(count);
+    _normals.reserve(count);
+    _dirty.reserve(count);
+    _changed.reserve(count);
+}
+
+void SceneGraph::clear() {
+    _parents.clear();
+    _transforms.resize(0);
+    _locals.clear();
+    _localNormals.clear();
+    _worlds.clear();
+    _normals.clear();
+    _dirty.clear();
+    _changed.clear();
+    _dirtyCount = 0;
+    _order.clear();
+    _orderValid = true;
+    _updated.clear();
+}
+
+size_t SceneGraph::getNodeCount() const {
+    return _parents.size();
+}
+
+size_t SceneGraph::getParent(size_t node) const {
+    return _parents[node];
+}
+
+const glm::mat4& SceneGraph::getLocalTransform(size_t node) const {
+    return _locals[node];
+}
+
+const glm::mat4& SceneGraph::getWorldMatrix(size_t node) const {
+    return _worlds[node];
+}
+
+const glm::mat3& SceneGraph::getNormalMatrix(size_t node) const {
+    return _normals[node];
+}
+
+const std::vector<size_t>& SceneGraph::getUpdatedNodes() const {
+    return _updated;
+}
+
+size_t SceneGraph::getRecomputedCount() const {
+    return _updated.size();
+}
+
+void SceneGraph::update() {
+    _updated.clear();
+    if (_dirtyCount == 0) {
+        return;
+    }
+    if (!_orderValid) {
+        buildOrder();
+    }
+    composeDirtyLocals();
+
+    // A node is recomputed when it or an ancestor was dirty. Parents come
+    // first, so their flag is already current when a child reads it.
+    for (size_t node : _order) {
+        size_t parent = _parents[node];
+        bool parentChanged = parent != NoParent && _changed[parent];
+        if (!_dirty[node] && !parentChanged) {
+            _changed[node] = 0;
+            continue;
+        }
+        // The inverse transpose of a product is the product of the inverse
+        // transposes, so normal matrices compose like the world matrices
+        const float* n = &_localNormals[node * NormalMatrixFloats];
+        glm::mat3 localNormal(n[0], n[1], n[2], n[4], n[5], n[6], n[8], n[9], n[10]);
+        if (parent == NoParent) {
+            _worlds[node] = _locals[node];
+            _normals[node] = localNormal;
+        } else {
+            _worlds[node] = _worlds[parent] * _locals[node];
+            _normals[node] = _normals[parent] * localNormal;
+        }
+        _dirty[node] = 0;
+        _changed[node] = 1;
+        _updated.push_back(node);
+    }
+    _dirtyCount = 0;
+}
+
+// Runs of consecutive dirty nodes go through the batch kernel together,
+// a freshly built level is one run
+void SceneGraph::composeDirtyLocals() {
+    size_t count = _parents.size();
+    size_t node = 0;
+    while (node < count) {
+        if (!_dirty[node]) {
+            node++;
+            continue;
+        }
+        size_t first = node;
+        while (node < count && _dirty[node]) {
+            node++;
+        }
+        composeTransforms(_transforms, first, node - first, &_locals[0][0][0], &_localNormals[0]);
+    }
+}
+
+void SceneGraph::buildOrder() {
+    size_t count = _parents.size();
+    std::vector<std::vector<size_t>> children(count);
+    for (size_t node = 0; node < count; node++) {
+        if (_parents[node] != NoParent && _parents[node] >= count) {
+            std::cerr << "Scene graph node " << node << " has an invalid parent, detached" << std::endl;
+            _parents[node] = NoParent;
+        }
+        if (_parents[node] != NoParent) {
+            children[_parents[node]].push_back(node);
+        }
+    }
+
+    // Depth first from each root. A node never reached hangs off a cycle:
+    // following parent links from it must repeat a node, which lies on the
+    // cycle and is detached to become a root.
+    _order.clear();
+    std::vector<uint8_t> visited(count, 0);
+    std::vector<uint8_t> onPath(count, 0);
+    std::vector<size_t> stack;
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t start = 0; start < count; start++) {
+            if (visited[start] || (pass == 0 && _parents[start] != NoParent)) {
+                continue;
+            }
+            size_t root = start;
+            if (pass == 1) {
+                while (!onPath[root]) {
+                    onPath[root] = 1;
+                    root = _parents[root];
+                }
+                std::cerr << "Scene graph cycle at node " << root << ", detached from its parent" << std::endl;
+                _parents[root] = NoParent;
+                if (!_dirty[root]) {
+                    _dirty[root] = 1;
+                    _dirtyCount++;
+                }
+            }
+            stack.push_back(root);
+            while (!stack.empty()) {
+                size_t node = stack.back();
+                stack.pop_back();
+                visited[node] = 1;
+                _order.push_back(node);
+                for (size_t child : children[node]) {
+                    if (!visited[child] && _parents[child] == node) {
+                        stack.push_back(child);
+                    }
+                }
+            }
+        }
+    }
+    _orderValid = true;
+}
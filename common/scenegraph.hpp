@@ -0,0 +1,65 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "transformbatch.hpp"
+
+#ifndef SCENEGRAPH_HPP
+#define SCENEGRAPH_HPP
+
+// Parent/child transform hierarchy. Local transforms live in SoA arrays
+// and every node caches its local-to-world and normal matrix. Setting a
+// local transform only marks the node dirty, update() composes the dirty
+// locals with the batch kernel and recomputes the dirty nodes and their
+// descendants, nothing else.
+class SceneGraph {
+public:
+    static const size_t NoParent = (size_t)-1;
+
+    SceneGraph();
+
+    // Parents may be added after their children, cycles are broken by the
+    // next update()
+    // Location and rotation about Y, like Object
+    size_t addNode(float x, float y, float z, float angle, size_t parent = NoParent);
+    void setParent(size_t node, size_t parent);
+    void setLocalTransform(size_t node, float x, float y, float z, float angle);
+    void reserve(size_t count);
+    void clear();
+
+    size_t getNodeCount() const;
+    size_t getParent(size_t node) const;
+    // Composed by the last update()
+    const glm::mat4& getLocalTransform(size_t node) const;
+    const glm::mat4& getWorldMatrix(size_t node) const;
+    // Inverse transpose of the world matrix's upper 3x3
+    const glm::mat3& getNormalMatrix(size_t node) const;
+
+    // Recomputes the world matrix of every dirty node and of everything
+    // below it, parents first
+    void update();
+    // Nodes whose world matrix the last update() recomputed
+    const std::vector<size_t>& getUpdatedNodes() const;
+    size_t getRecomputedCount() const;
+
+private:
+    std::vector<size_t> _parents;
+    TransformArrays _transforms;
+    std::vector<glm::mat4> _locals;
+    std::vector<float> _localNormals;   // NormalMatrixFloats per node
+    std::vector<glm::mat4> _worlds;
+    std::vector<glm::mat3> _normals;
+    std::vector<uint8_t> _dirty;
+    std::vector<uint8_t> _changed;  // Recomputed in the current update()
+    size_t _dirtyCount;
+
+    // Every node after its parent, rebuilt when the hierarchy changes
+    std::vector<size_t> _order;
+    bool _orderValid;
+    std::vector<size_t> _updated;
+
+    void buildOrder();
+    void composeDirtyLocals();
+};
+
+#endif
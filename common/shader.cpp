@@ -14,14 +14,30 @@ using namespace std;
 
 #include "shader.hpp"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+// Inserts a #define line per entry right after the #version directive,
+// which has to stay the first statement of the shader
+static void InjectDefines(std::string& code, const std::vector<std::string>& defines){
+	if (defines.empty())
+		return;
+
+	std::string block;
+	for (const std::string& define : defines)
+		block += "#define " + define + "\n";
+
+	size_t insertAt = 0;
+	size_t version = code.find("#version");
+	if (version != std::string::npos){
+		size_t lineEnd = code.find('\n', version);
+		insertAt = lineEnd == std::string::npos ? code.size() : lineEnd + 1;
+		if (lineEnd == std::string::npos)
+			block = "\n" + block;
+	}
+	code.insert(insertAt, block);
+}
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+bool ReadShaderSources(const char * vertex_file_path,const char * fragment_file_path, const std::vector<std::string>& defines, std::string& VertexShaderCode, std::string& FragmentShaderCode){
 
 	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
 	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
 	if(VertexShaderStream.is_open()){
 		std::stringstream sstr;
@@ -31,11 +47,10 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	}else{
 		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
 		getchar();
-		return 0;
+		return false;
 	}
 
 	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
 	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
 	if(FragmentShaderStream.is_open()){
 		std::stringstream sstr;
@@ -44,67 +59,116 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 		FragmentShaderStream.close();
 	}
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	InjectDefines(VertexShaderCode, defines);
+	InjectDefines(FragmentShaderCode, defines);
+	return true;
+}
 
+// Lets the driver compile on as many threads as it likes, once per context
+static void EnableParallelCompile(){
+	static bool enabled = false;
+	if (enabled)
+		return;
+	enabled = true;
+	if (GLEW_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+bool SubmitShaders(const char * vertex_file_path,const char * fragment_file_path, const std::string& VertexShaderCode, const std::string& FragmentShaderCode, bool retrievable, ShaderJob& job){
+	EnableParallelCompile();
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
-	}
+	job.vertexPath = vertex_file_path;
+	job.fragmentPath = fragment_file_path;
 
+	// Create the shaders
+	job.vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	job.fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 
+	// Compile Vertex Shader, the status is read in FinishShaders
+	printf("Compiling shader : %s\n", vertex_file_path);
+	char const * VertexSourcePointer = VertexShaderCode.c_str();
+	glShaderSource(job.vertexShaderID, 1, &VertexSourcePointer , NULL);
+	glCompileShader(job.vertexShaderID);
 
 	// Compile Fragment Shader
 	printf("Compiling shader : %s\n", fragment_file_path);
 	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
+	glShaderSource(job.fragmentShaderID, 1, &FragmentSourcePointer , NULL);
+	glCompileShader(job.fragmentShaderID);
+
+	// Link the program
+	printf("Linking program\n");
+	job.programID = glCreateProgram();
+	// Has to be set before linking for glGetProgramBinary to work
+	if (retrievable)
+		glProgramParameteri(job.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(job.programID, job.vertexShaderID);
+	glAttachShader(job.programID, job.fragmentShaderID);
+	glLinkProgram(job.programID);
+	return job.programID != 0;
+}
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+bool IsShaderJobComplete(const ShaderJob& job){
+	if (!GLEW_KHR_parallel_shader_compile)
+		return true;
+	GLint Complete = GL_FALSE;
+	glGetProgramiv(job.programID, GL_COMPLETION_STATUS_KHR, &Complete);
+	return Complete == GL_TRUE;
+}
+
+static void PrintShaderLog(GLuint ShaderID){
+	int InfoLogLength = 0;
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
+		std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s\n", &ShaderErrorMessage[0]);
 	}
+}
 
+bool FinishShaders(ShaderJob& job){
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
 
-
-	// Link the program
-	printf("Linking program\n");
-	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
-
-	// Check the program
-	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	// Check the shaders and the program, these wait for the driver
+	PrintShaderLog(job.vertexShaderID);
+	PrintShaderLog(job.fragmentShaderID);
+	glGetProgramiv(job.programID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(job.programID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
 		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+		glGetProgramInfoLog(job.programID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
 		printf("%s\n", &ProgramErrorMessage[0]);
 	}
 
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+	ReleaseShaders(job);
+	return Result == GL_TRUE;
+}
+
+void ReleaseShaders(ShaderJob& job){
+	if (job.vertexShaderID == 0 && job.fragmentShaderID == 0)
+		return;
+
+	glDetachShader(job.programID, job.vertexShaderID);
+	glDetachShader(job.programID, job.fragmentShaderID);
+
+	glDeleteShader(job.vertexShaderID);
+	glDeleteShader(job.fragmentShaderID);
+	job.vertexShaderID = 0;
+	job.fragmentShaderID = 0;
+}
 
-	return ProgramID;
+GLuint CompileShaders(const char * vertex_file_path,const char * fragment_file_path, const std::string& VertexShaderCode, const std::string& FragmentShaderCode, bool retrievable){
+	ShaderJob job;
+	SubmitShaders(vertex_file_path, fragment_file_path, VertexShaderCode, FragmentShaderCode, retrievable, job);
+	FinishShaders(job);
+	return job.programID;
 }
 
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const std::vector<std::string>& defines){
+	std::string VertexShaderCode;
+	std::string FragmentShaderCode;
+	if (!ReadShaderSources(vertex_file_path, fragment_file_path, defines, VertexShaderCode, FragmentShaderCode))
+		return 0;
+	return CompileShaders(vertex_file_path, fragment_file_path, VertexShaderCode, FragmentShaderCode);
+}
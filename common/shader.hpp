@@ -1,6 +1,41 @@
+#include <string>
+#include <vector>
+
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+// defines are injected after the #version line, e.g. "QUANTIZED_VERTICES"
+// or "NUM_LIGHTS 4"
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path, const std::vector<std::string>& defines = std::vector<std::string>());
+
+// The two halves of LoadShaders, for callers that need the final sources
+// before compiling, e.g. to look up a cached program binary. retrievable
+// asks the driver to keep the linked binary for glGetProgramBinary.
+bool ReadShaderSources(const char * vertex_file_path,const char * fragment_file_path, const std::vector<std::string>& defines, std::string& VertexShaderCode, std::string& FragmentShaderCode);
+GLuint CompileShaders(const char * vertex_file_path,const char * fragment_file_path, const std::string& VertexShaderCode, const std::string& FragmentShaderCode, bool retrievable = false);
+
+// CompileShaders without waiting for the driver. SubmitShaders issues the
+// compiles and the link and returns at once, so a level can submit every
+// program before the first status check. With KHR_parallel_shader_compile
+// the driver compiles them on its own threads.
+struct ShaderJob {
+	GLuint programID;
+	GLuint vertexShaderID;
+	GLuint fragmentShaderID;
+	std::string vertexPath;
+	std::string fragmentPath;
+
+	ShaderJob() : programID(0), vertexShaderID(0), fragmentShaderID(0) {}
+};
+
+bool SubmitShaders(const char * vertex_file_path,const char * fragment_file_path, const std::string& VertexShaderCode, const std::string& FragmentShaderCode, bool retrievable, ShaderJob& job);
+// Polls GL_COMPLETION_STATUS_KHR. Without the extension it always returns
+// true and FinishShaders waits instead.
+bool IsShaderJobComplete(const ShaderJob& job);
+// Prints the compile and link logs, releases the shaders and returns the
+// link status
+bool FinishShaders(ShaderJob& job);
+// Deletes the shaders of a job that will not be finished
+void ReleaseShaders(ShaderJob& job);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "uniformblocks.hpp"
+
+#include "shaderprogram.hpp"
+
+ShaderProgram::ShaderProgram(GLuint programID) : _programID(programID), _pending(false), _failed(false) {
+    linked();
+}
+
+ShaderProgram::ShaderProgram(const ShaderJob& job) : _programID(job.programID), _job(job), _pending(true), _failed(false) {
+    _locations.ready = false;
+    _locations.model = -1;
+    _locations.normalMatrix = -1;
+    _locations.objectColor = -1;
+    _locations.positionOffset = -1;
+    _locations.positionScale = -1;
+}
+
+ShaderProgram::~ShaderProgram() {
+    ReleaseShaders(_job);
+    glDeleteProgram(_programID);
+}
+
+bool ShaderProgram::poll() {
+    if (_pending && IsShaderJobComplete(_job)) {
+        finish();
+    }
+    return _locations.ready;
+}
+
+bool ShaderProgram::finish() {
+    if (!_pending) {
+        return _locations.ready;
+    }
+    _pending = false;
+    if (!FinishShaders(_job)) {
+        std::cerr << "Program " << _programID << " failed to link: " << _job.vertexPath << ", " << _job.fragmentPath << std::endl;
+        _failed = true;
+        return false;
+    }
+    linked();
+    return true;
+}
+
+bool ShaderProgram::isReady() const {
+    return _locations.ready;
+}
+
+bool ShaderProgram::hasFailed() const {
+    return _failed;
+}
+
+void ShaderProgram::linked() {
+    reflectUniforms();
+    bindUniformBlock("Camera", CameraBlockBinding, sizeof(CameraBlock));
+    bindUniformBlock("Lights", LightsBlockBinding, sizeof(LightsBlock));
+    _locations.ready = true;
+}
+
+GLuint ShaderProgram::getID() const {
+    return _programID;
+}
+
+const std::vector<UniformInfo>& ShaderProgram::getUniforms() const {
+    return _uniforms;
+}
+
+const ProgramUniforms& ShaderProgram::getLocations() const {
+    return _locations;
+}
+
+GLint ShaderProgram::findLocation(const std::string& name) const {
+    const UniformInfo* uniform = find(name);
+    return uniform ? uniform->location : -1;
+}
+
+const UniformInfo* ShaderProgram::find(const std::string& name) const {
+    for (const UniformInfo& uniform : _uniforms) {
+        if (uniform.name == name || (uniform.size > 1 && uniform.name == name + "[0]")) {
+            return &uniform;
+        }
+    }
+    return nullptr;
+}
+
+void ShaderProgram::reflectUniforms() {
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(_programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> name(maxLength > 0 ? maxLength : 1);
+    for (GLint i = 0; i < count; i++) {
+        UniformInfo uniform;
+        GLsizei length = 0;
+        glGetActiveUniform(_programID, (GLuint)i, (GLsizei)name.size(), &length, &uniform.size, &uniform.type, name.data());
+        uniform.name.assign(name.data(), length);
+        // Uniforms in blocks have no location
+        uniform.location = glGetUniformLocation(_programID, uniform.name.c_str());
+        _uniforms.push_back(uniform);
+    }
+
+    _locations.model = resolve("model", GL_FLOAT_MAT4);
+    _locations.normalMatrix = resolve("normalMatrix", GL_FLOAT_MAT3);
+    _locations.objectColor = resolve("objectColor", GL_FLOAT_VEC3);
+    _locations.positionOffset = resolve("positionOffset", GL_FLOAT_VEC3);
+    _locations.positionScale = resolve("positionScale", GL_FLOAT_VEC3);
+
+    std::cerr << "Program " << _programID << ": " << _uniforms.size() << " active uniforms" << std::endl;
+}
+
+GLint ShaderProgram::resolve(const std::string& name, GLenum type) const {
+    const UniformInfo* uniform = find(name);
+    if (!uniform) {
+        return -1;
+    }
+    if (uniform->type != type) {
+        std::cerr << "Uniform " << name << " of program " << _programID << " has an unexpected type" << std::endl;
+        return -1;
+    }
+    return uniform->location;
+}
+
+// Points a block at its fixed binding. Drivers may or may not round the
+// block size up to 16 bytes, any other difference from the C++ mirror
+// means the shader and uniformblocks.hpp disagree on the layout.
+void ShaderProgram::bindUniformBlock(const char* name, GLuint binding, size_t expectedSize) {
+    GLuint index = glGetUniformBlockIndex(_programID, name);
+    if (index == GL_INVALID_INDEX) {
+        return;
+    }
+    GLint size = 0;
+    glGetActiveUniformBlockiv(_programID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    if ((size_t)size > expectedSize || (size_t)size + 16 <= expectedSize) {
+        std::cerr << "Uniform block " << name << " of program " << _programID << " is " << size
+                  << " bytes, expected " << expectedSize << std::endl;
+    }
+    glUniformBlockBinding(_programID, index, binding);
+}
@@ -0,0 +1,81 @@
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include "shader.hpp"
+
+#ifndef SHADERPROGRAM_HPP
+#define SHADERPROGRAM_HPP
+
+// One active uniform as reported by glGetActiveUniform, members of
+// uniform blocks included with location -1. Arrays of basic
+// types are one entry named "name[0]" with size elements, arrays of
+// structs one entry per member and element, e.g. "lights[1].color".
+struct UniformInfo {
+    std::string name;
+    GLenum type;
+    GLint size;
+    GLint location;
+};
+
+// Locations of the per-object uniforms the render loop sets, resolved
+// once after linking. -1 when the program does not use one or its type
+// differs, GL ignores uploads to -1. Camera and lights come from the
+// uniform blocks in uniformblocks.hpp instead.
+struct ProgramUniforms {
+    // Set once the program linked and the locations are resolved, the
+    // render loop skips items whose program is still compiling
+    bool ready;
+    GLint model;
+    GLint normalMatrix;
+    GLint objectColor;
+    GLint positionOffset;
+    GLint positionScale;
+};
+
+// A linked program and its uniform table, shared by every object drawn
+// with it. The program is deleted with the last reference, so it must not
+// outlive the GL context.
+class ShaderProgram {
+public:
+    // Takes ownership of a program returned by LoadShaders
+    ShaderProgram(GLuint programID);
+    // Takes ownership of a submitted job, the program is not ready until
+    // poll() or finish() sees it linked
+    ShaderProgram(const ShaderJob& job);
+    ~ShaderProgram();
+
+    // Non-blocking with KHR_parallel_shader_compile. True once ready.
+    bool poll();
+    // Waits for the driver
+    bool finish();
+    bool isReady() const;
+    // Finished but failed to compile or link, never becomes ready
+    bool hasFailed() const;
+
+    GLuint getID() const;
+    const std::vector<UniformInfo>& getUniforms() const;
+    const ProgramUniforms& getLocations() const;
+
+    // Location from the table, "name" also finds "name[0]". -1 if the
+    // uniform is not active.
+    GLint findLocation(const std::string& name) const;
+
+private:
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    GLuint _programID;
+    ShaderJob _job;
+    bool _pending;
+    bool _failed;
+    std::vector<UniformInfo> _uniforms;
+    ProgramUniforms _locations;
+
+    void linked();
+    void reflectUniforms();
+    void bindUniformBlock(const char* name, GLuint binding, size_t expectedSize);
+    const UniformInfo* find(const std::string& name) const;
+    GLint resolve(const std::string& name, GLenum type) const;
+};
+
+#endif
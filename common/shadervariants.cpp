@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "shadervariants.hpp"
+
+// Index of the axis, -1 if it is not declared
+static int findAxis(const std::vector<PermutationAxis>& axes, const std::string& name) {
+    for (size_t i = 0; i < axes.size(); i++) {
+        if (axes[i].name == name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool readPermutationAxes(const std::string& filePath, std::vector<PermutationAxis>& axes) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        std::cerr << "Error opening shader: " << filePath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream tokens(line);
+        std::string directive;
+        std::string pragma;
+        PermutationAxis axis;
+        if (!(tokens >> directive >> pragma >> axis.name) || directive != "#pragma" || pragma != "permutation") {
+            continue;
+        }
+        std::string value;
+        while (tokens >> value) {
+            axis.values.push_back(atoi(value.c_str()));
+        }
+        std::sort(axis.values.begin(), axis.values.end());
+        axis.values.erase(std::unique(axis.values.begin(), axis.values.end()), axis.values.end());
+
+        // Both stages may declare the same axis, the values are merged
+        int existing = findAxis(axes, axis.name);
+        if (existing < 0) {
+            axes.push_back(axis);
+            continue;
+        }
+        std::vector<int>& values = axes[existing].values;
+        std::vector<int> merged;
+        std::set_union(values.begin(), values.end(), axis.values.begin(), axis.values.end(), std::back_inserter(merged));
+        values.swap(merged);
+    }
+    return true;
+}
+
+const std::vector<PermutationAxis>& ShaderVariants::getAxes(const std::string& vertexPath, const std::string& fragmentPath) {
+    std::string key = vertexPath + "|" + fragmentPath;
+    std::map<std::string, std::vector<PermutationAxis>>::iterator it = _axes.find(key);
+    if (it != _axes.end()) {
+        return it->second;
+    }
+    std::vector<PermutationAxis>& axes = _axes[key];
+    readPermutationAxes(vertexPath, axes);
+    readPermutationAxes(fragmentPath, axes);
+    return axes;
+}
+
+std::vector<std::string> ShaderVariants::select(const std::string& vertexPath, const std::string& fragmentPath,
+                                                const VariantFeatures& features) {
+    const std::vector<PermutationAxis>& axes = getAxes(vertexPath, fragmentPath);
+    std::vector<std::string> defines;
+
+    // Only axes the shaders declare, anything else would split the program
+    // registry into variants that compile to the same program
+    if (features.quantized && findAxis(axes, "QUANTIZED_VERTICES") >= 0) {
+        defines.push_back("QUANTIZED_VERTICES");
+    }
+    if (features.instanced && findAxis(axes, "INSTANCED") >= 0) {
+        defines.push_back("INSTANCED");
+    }
+
+    // Shaders without a light count axis keep their runtime loop
+    int lights = findAxis(axes, "NUM_LIGHTS");
+    if (lights >= 0 && !axes[lights].values.empty()) {
+        const std::vector<int>& values = axes[lights].values;
+        int count = values.back();
+        for (int value : values) {
+            if (value >= features.lightCount) {
+                count = value;
+                break;
+            }
+        }
+        defines.push_back("NUM_LIGHTS " + std::to_string(count));
+    }
+    return defines;
+}
+
+size_t ShaderVariants::countPermutations(const std::string& vertexPath, const std::string& fragmentPath) {
+    size_t count = 1;
+    for (const PermutationAxis& axis : getAxes(vertexPath, fragmentPath)) {
+        count *= axis.values.empty() ? 2 : axis.values.size();
+    }
+    return count;
+}
@@ -0,0 +1,50 @@
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef SHADERVARIANTS_HPP
+#define SHADERVARIANTS_HPP
+
+// A permutation axis a shader declares with
+//   #pragma permutation NAME            on/off, NAME is defined or not
+//   #pragma permutation NAME 1 2 4      NAME is defined to one of the values
+// GL ignores unknown pragmas, so the declarations cost nothing at compile
+// time.
+struct PermutationAxis {
+    std::string name;
+    std::vector<int> values;    // Ascending, empty for an on/off axis
+};
+
+// What an object needs from its shaders
+struct VariantFeatures {
+    int lightCount;
+    bool quantized;
+    bool instanced;
+};
+
+// Reads the axes of vertex/fragment shader pairs and picks the variant an
+// object needs. No GL calls, so tools can enumerate a level's variants.
+class ShaderVariants {
+public:
+    // Axes of both shaders, each name once. Files are read once per pair.
+    const std::vector<PermutationAxis>& getAxes(const std::string& vertexPath, const std::string& fragmentPath);
+
+    // Defines of the tightest variant, for declared axes only: NUM_LIGHTS
+    // is the smallest declared count that covers lightCount, so the light
+    // loop has a constant bound the compiler can unroll. QUANTIZED_VERTICES
+    // and INSTANCED change the vertex inputs and are defined whenever the
+    // object needs them.
+    std::vector<std::string> select(const std::string& vertexPath, const std::string& fragmentPath,
+                                    const VariantFeatures& features);
+
+    // Every combination the axes allow
+    size_t countPermutations(const std::string& vertexPath, const std::string& fragmentPath);
+
+private:
+    std::map<std::string, std::vector<PermutationAxis>> _axes;
+};
+
+// Appends the axes declared in one shader file, false if it cannot be read
+bool readPermutationAxes(const std::string& filePath, std::vector<PermutationAxis>& axes);
+
+#endif
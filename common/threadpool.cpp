@@ -0,0 +1,60 @@
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(unsigned int threads) : _stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        _threads.push_back(std::thread(&ThreadPool::run, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        _jobs.clear();
+    }
+    _wake.notify_all();
+    for (std::thread& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(const std::function<void()>& job) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(job);
+    }
+    _wake.notify_one();
+}
+
+size_t ThreadPool::getThreadCount() const {
+    return _threads.size();
+}
+
+void ThreadPool::run() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stopping && _jobs.empty()) {
+                _wake.wait(lock);
+            }
+            if (_stopping) {
+                return;
+            }
+            job = _jobs.front();
+            _jobs.pop_front();
+        }
+        job();
+    }
+}
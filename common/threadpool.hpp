@@ -0,0 +1,36 @@
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+// Fixed set of worker threads running submitted jobs in FIFO order.
+// Destroying the pool drops jobs that have not started yet and waits for
+// the running ones.
+class ThreadPool {
+public:
+    // 0 uses every hardware thread
+    ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+
+    void submit(const std::function<void()>& job);
+    size_t getThreadCount() const;
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _jobs;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stopping;
+
+    void run();
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define TRANSFORMBATCH_SSE 1
+#endif
+
+#include "transformbatch.hpp"
+
+size_t TransformArrays::size() const {
+    return x.size();
+}
+
+void TransformArrays::resize(size_t count) {
+    x.resize(count, 0.0f);
+    y.resize(count, 0.0f);
+    z.resize(count, 0.0f);
+    sin.resize(count, 0.0f);
+    cos.resize(count, 1.0f);
+    scaleX.resize(count, 1.0f);
+    scaleY.resize(count, 1.0f);
+    scaleZ.resize(count, 1.0f);
+}
+
+void TransformArrays::set(size_t index, float locationX, float locationY, float locationZ, float angle, float scale) {
+    x[index] = locationX;
+    y[index] = locationY;
+    z[index] = locationZ;
+    sin[index] = std::sin(angle);
+    cos[index] = std::cos(angle);
+    scaleX[index] = scale;
+    scaleY[index] = scale;
+    scaleZ[index] = scale;
+}
+
+// With c and s the rotation's cosine and sine, the model matrix columns are
+//   (c * sx, 0, -s * sx, 0), (0, sy, 0, 0), (s * sz, 0, c * sz, 0), (x, y, z, 1)
+// and the inverse transpose of its upper 3x3 is the same rotation with
+// the scales inverted.
+void composeTransformsScalar(const TransformArrays& transforms, size_t first, size_t count, float* models, float* normals) {
+    for (size_t i = first; i < first + count; i++) {
+        float c = transforms.cos[i];
+        float s = transforms.sin[i];
+        float sx = transforms.scaleX[i];
+        float sy = transforms.scaleY[i];
+        float sz = transforms.scaleZ[i];
+
+        float* model = models + i * ModelMatrixFloats;
+        model[0] = c * sx;  model[1] = 0.0f;    model[2] = -s * sx; model[3] = 0.0f;
+        model[4] = 0.0f;    model[5] = sy;      model[6] = 0.0f;    model[7] = 0.0f;
+        model[8] = s * sz;  model[9] = 0.0f;    model[10] = c * sz; model[11] = 0.0f;
+        model[12] = transforms.x[i];
+        model[13] = transforms.y[i];
+        model[14] = transforms.z[i];
+        model[15] = 1.0f;
+
+        if (normals) {
+            float* normal = normals + i * NormalMatrixFloats;
+            normal[0] = c / sx; normal[1] = 0.0f;     normal[2] = -s / sx;  normal[3] = 0.0f;
+            normal[4] = 0.0f;   normal[5] = 1.0f / sy; normal[6] = 0.0f;    normal[7] = 0.0f;
+            normal[8] = s / sz; normal[9] = 0.0f;     normal[10] = c / sz;  normal[11] = 0.0f;
+        }
+    }
+}
+
+#ifdef TRANSFORMBATCH_SSE
+// Each register holds one matrix element for four objects. Transposing
+// four of them gives one column for each of the four objects.
+static inline void storeColumns(float* out, size_t stride, size_t column, __m128 a, __m128 b, __m128 c, __m128 d) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(out + column * 4, a);
+    _mm_storeu_ps(out + stride + column * 4, b);
+    _mm_storeu_ps(out + 2 * stride + column * 4, c);
+    _mm_storeu_ps(out + 3 * stride + column * 4, d);
+}
+
+static void composeTransformsSse(const TransformArrays& transforms, size_t first, size_t count, float* models, float* normals) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (size_t i = first; i < first + count; i += 4) {
+        __m128 c = _mm_loadu_ps(&transforms.cos[i]);
+        __m128 s = _mm_loadu_ps(&transforms.sin[i]);
+        __m128 sx = _mm_loadu_ps(&transforms.scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&transforms.scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&transforms.scaleZ[i]);
+        __m128 negativeS = _mm_sub_ps(zero, s);
+
+        float* model = models + i * ModelMatrixFloats;
+        storeColumns(model, ModelMatrixFloats, 0, _mm_mul_ps(c, sx), zero, _mm_mul_ps(negativeS, sx), zero);
+        storeColumns(model, ModelMatrixFloats, 1, zero, sy, zero, zero);
+        storeColumns(model, ModelMatrixFloats, 2, _mm_mul_ps(s, sz), zero, _mm_mul_ps(c, sz), zero);
+        storeColumns(model, ModelMatrixFloats, 3, _mm_loadu_ps(&transforms.x[i]), _mm_loadu_ps(&transforms.y[i]),
+            _mm_loadu_ps(&transforms.z[i]), one);
+
+        if (normals) {
+            __m128 ix = _mm_div_ps(one, sx);
+            __m128 iz = _mm_div_ps(one, sz);
+            float* normal = normals + i * NormalMatrixFloats;
+            storeColumns(normal, NormalMatrixFloats, 0, _mm_mul_ps(c, ix), zero, _mm_mul_ps(negativeS, ix), zero);
+            storeColumns(normal, NormalMatrixFloats, 1, zero, _mm_div_ps(one, sy), zero, zero);
+            storeColumns(normal, NormalMatrixFloats, 2, _mm_mul_ps(s, iz), zero, _mm_mul_ps(c, iz), zero);
+        }
+    }
+}
+#endif
+
+void composeTransforms(const TransformArrays& transforms, size_t first, size_t count, float* models, float* normals) {
+#ifdef TRANSFORMBATCH_SSE
+    // Groups of four, the remainder one at a time
+    size_t batched = count & ~(size_t)3;
+    composeTransformsSse(transforms, first, batched, models, normals);
+    composeTransformsScalar(transforms, first + batched, count - batched, models, normals);
+#else
+    composeTransformsScalar(transforms, first, count, models, normals);
+#endif
+}
+
+bool hasSimdTransforms() {
+#ifdef TRANSFORMBATCH_SSE
+    return true;
+#else
+    return false;
+#endif
+}
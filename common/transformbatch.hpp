@@ -0,0 +1,41 @@
+#include <cstddef>
+#include <vector>
+
+#ifndef TRANSFORMBATCH_HPP
+#define TRANSFORMBATCH_HPP
+
+// Local transforms of many objects as a structure of arrays, so a batch
+// kernel can read each component with contiguous vector loads. Rotation
+// is about Y only, like Object, and kept as its sine and cosine.
+struct TransformArrays {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> sin;
+    std::vector<float> cos;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> scaleZ;
+
+    size_t size() const;
+    void resize(size_t count);
+    void set(size_t index, float locationX, float locationY, float locationZ, float angle, float scale = 1.0f);
+};
+
+// Floats written per object: a column-major 4x4 model matrix, and the
+// normal matrix as three vec4 columns (std140 mat3 layout)
+static const size_t ModelMatrixFloats = 16;
+static const size_t NormalMatrixFloats = 12;
+
+// Writes translate * rotateY * scale and its inverse transpose for objects
+// [first, first + count) into packed output arrays indexed from first.
+// normals may be null. Uses SSE four objects at a time where available.
+void composeTransforms(const TransformArrays& transforms, size_t first, size_t count, float* models, float* normals);
+
+// One object at a time, the reference for the SIMD path and its tail
+void composeTransformsScalar(const TransformArrays& transforms, size_t first, size_t count, float* models, float* normals);
+
+// Whether composeTransforms() was built with the SSE kernel
+bool hasSimdTransforms();
+
+#endif
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "light.hpp"
+#include "glcallcounter.hpp"
+
+#include "uniformblocks.hpp"
+
+static GLuint createUniformBuffer(size_t size, GLuint binding) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    return buffer;
+}
+
+FrameUniforms::FrameUniforms() {
+    _camera.view = glm::mat4(1.0f);
+    _camera.projection = glm::mat4(1.0f);
+    for (int i = 0; i < MaxLights; i++) {
+        _lights.lights[i].position = glm::vec3(0.0f);
+        _lights.lights[i].padding = 0.0f;
+        _lights.lights[i].color = glm::vec3(0.0f);
+        _lights.lights[i].intensity = 0.0f;
+    }
+    _lights.numLights = 0;
+    _lights.padding[0] = _lights.padding[1] = _lights.padding[2] = 0;
+    _cameraBuffer = createUniformBuffer(sizeof(CameraBlock), CameraBlockBinding);
+    _lightsBuffer = createUniformBuffer(sizeof(LightsBlock), LightsBlockBinding);
+}
+
+FrameUniforms::~FrameUniforms() {
+    glDeleteBuffers(1, &_cameraBuffer);
+    glDeleteBuffers(1, &_lightsBuffer);
+}
+
+void FrameUniforms::update(const glm::mat4& view, const glm::mat4& projection, const std::vector<Light>& lights) {
+    _camera.view = view;
+    _camera.projection = projection;
+    GL_COUNTED(glBindBuffer(GL_UNIFORM_BUFFER, _cameraBuffer));
+    GL_COUNTED(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &_camera));
+
+    _lights.numLights = std::min((int)lights.size(), MaxLights);
+    for (int i = 0; i < _lights.numLights; i++) {
+        _lights.lights[i].position = lights[i].position;
+        _lights.lights[i].color = lights[i].color;
+        _lights.lights[i].intensity = lights[i].intensity;
+    }
+    GL_COUNTED(glBindBuffer(GL_UNIFORM_BUFFER, _lightsBuffer));
+    GL_COUNTED(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightsBlock), &_lights));
+    GL_COUNTED(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "light.hpp"
+
+#ifndef UNIFORMBLOCKS_HPP
+#define UNIFORMBLOCKS_HPP
+
+// Binding points of the per-frame uniform blocks, assigned to every
+// program after linking since GLSL 3.30 has no binding layout qualifier
+static const GLuint CameraBlockBinding = 0;
+static const GLuint LightsBlockBinding = 1;
+
+// std140 mirror of the Camera block in SimpleVertexShader.glsl
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 projection;
+};
+
+// std140 mirror of the Lights block in SimpleFragmentShader.glsl. A vec3
+// is 16 byte aligned, the float after it fills the last 4 bytes.
+struct LightBlockEntry {
+    glm::vec3 position;
+    float padding;
+    glm::vec3 color;
+    float intensity;
+};
+
+struct LightsBlock {
+    LightBlockEntry lights[MaxLights];
+    int32_t numLights;
+    int32_t padding[3];
+};
+
+static_assert(sizeof(CameraBlock) == 128, "CameraBlock must match the std140 layout");
+static_assert(sizeof(LightBlockEntry) == 32, "LightBlockEntry must match the std140 layout");
+static_assert(sizeof(LightsBlock) == 32 * MaxLights + 16, "LightsBlock must match the std140 layout");
+
+// Uniform buffers shared by every program, uploaded once per frame and
+// bound to their fixed binding points
+class FrameUniforms {
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    // Up to MaxLights lights are uploaded
+    void update(const glm::mat4& view, const glm::mat4& projection, const std::vector<Light>& lights);
+
+private:
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    GLuint _cameraBuffer;
+    GLuint _lightsBuffer;
+    CameraBlock _camera;
+    LightsBlock _lights;
+};
+
+#endif
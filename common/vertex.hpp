@@ -1,3 +1,6 @@
+#include <cstddef>
+#include <cstdint>
+
 #ifndef VERTEX_HPP
 #define VERTEX_HPP
 
@@ -6,4 +9,21 @@ struct Vertex {
     float nX, nY, nZ;
 };
 
-#endif
\ No newline at end of file
+// Compact vertex, 12 bytes instead of 24. The position is unorm16 relative
+// to the mesh bounds and the normal is octahedral encoded into two snorm16.
+struct PackedVertex {
+    uint16_t x, y, z;
+    uint16_t padding;
+    int16_t nU, nV;
+};
+
+enum VertexFormat {
+    VertexFormatFloat = 1,      // Vertex
+    VertexFormatQuantized = 2   // PackedVertex
+};
+
+inline size_t vertexStride(VertexFormat format) {
+    return format == VertexFormatQuantized ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+#endif
@@ -2,8 +2,14 @@
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <vector>
 
@@ -19,6 +25,11 @@
 #include "common/camera.hpp"
 
 #include "common/lvlloader.hpp"
+#include "common/allocationcounter.hpp"
+#include "common/glcallcounter.hpp"
+#include "common/shaderprogram.hpp"
+#include "common/uniformblocks.hpp"
+#include "common/drawlist.hpp"
 
 const int Width = 1280;
 const int Height = 720;
@@ -69,6 +80,17 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos)
     //camera.setYawPitch(yaw, pitch);
 }
 
+// Location reflected when the program was linked, or looked up by name
+// the way the draw loop did before, for comparing GL call counts
+GLint uniformLocation(GLuint programID, GLint cachedLocation, bool useCache, const char *name)
+{
+    if (useCache)
+    {
+        return cachedLocation;
+    }
+    return GL_COUNTED(glGetUniformLocation(programID, name));
+}
+
 GLFWwindow *initialize()
 {
     // Initialize GLFW
@@ -115,10 +137,20 @@ GLFWwindow *initialize()
     return window;
 }
 
-int main()
+// Milliseconds since start
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
 {
+    // Startup timing breakdown, printed once every model and program is ready
+    std::chrono::steady_clock::time_point startupStart = std::chrono::steady_clock::now();
+
     // Initialize window
     GLFWwindow *window = initialize();
+    double contextMilliseconds = millisecondsSince(startupStart);
 
     if (!window)
     {
@@ -153,19 +185,87 @@ int main()
     bool show_another_window = false;
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
-    // Load level file
-    LvlLoader lvlLoader("../Level_01.json");
+    // OpenGL_Test [level.json] [--frames N]. With --frames, N frames are
+    // timed once the level has loaded and the program exits.
+    const char *levelPath = "../Level_01.json";
+    size_t benchmarkFrames = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            benchmarkFrames = strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            levelPath = argv[i];
+        }
+    }
+    if (benchmarkFrames > 0)
+    {
+        // Frame time, not the display's refresh rate
+        glfwSwapInterval(0);
+    }
+
+    // Load level file, meshes parse on loader threads and objects appear as they are uploaded
+    LvlLoader lvlLoader(levelPath, true);
+    const double uploadBudget = 0.004;
     std::cerr << "Loaded Level: " << lvlLoader.getName() << std::endl;
+    double levelMilliseconds = millisecondsSince(startupStart);
+    double firstFrameMilliseconds = 0.0;
+    double loadedMilliseconds = 0.0;
 
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
 
     // Projection matrix
-    glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)Width / (float)Height, 0.1f, 100.0f);
+    const float fieldOfView = glm::radians(60.0f);
+    const float farPlane = 100.0f;
+    glm::mat4 projection = glm::perspective(fieldOfView, (float)Width / (float)Height, 0.1f, farPlane);
+    const float projectionScale = 1.0f / tanf(fieldOfView * 0.5f);
+
+    // Triangles drawn last frame, for comparing with and without LODs
+    bool useLods = true;
+    size_t trianglesSubmitted = 0;
+
+    // Draw calls and instances drawn last frame
+    size_t drawCalls = 0;
+    size_t instancesDrawn = 0;
+
+    // Draws sorted by program, VAO and depth, and the binds made and
+    // skipped last frame because the state was already current
+    DrawList drawList;
+    bool sortDraws = true;
+    size_t programBinds = 0;
+    size_t programBindsSkipped = 0;
+    size_t vaoBinds = 0;
+    size_t vaoBindsSkipped = 0;
+
+    // Heap allocations made during the last frame, should stay at zero
+    size_t frameAllocations = 0;
+
+    // Totals over the timed frames of --frames
+    size_t measuredFrames = 0;
+    size_t measuredDrawCalls = 0;
+    size_t measuredTriangles = 0;
+    size_t measuredGLCalls = 0;
+    std::chrono::steady_clock::time_point measureStart;
+    size_t frameStartAllocations = getAllocationCount();
+
+    // ImGui labels are formatted into this, not std::string
+    char label[64];
+
+    // GL calls made by the draw loop during the last frame, with the
+    // reflected uniform locations or with a lookup per uniform and object
+    bool cacheUniforms = true;
+    size_t frameGLCalls = 0;
+    size_t frameStartGLCalls = getGLCallCount();
 
     // View matrix
     glm::mat4 view = camera.getLookAt();
 
+    // Camera and lights, shared by every program through uniform blocks
+    std::unique_ptr<FrameUniforms> frameUniforms(new FrameUniforms());
+
     // Set light properties as uniforms
     // glm::vec3 light_position = glm::vec3(0.0f, 3.0f, 2.0f);
     // glm::vec3 light_color = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -191,6 +291,9 @@ int main()
             continue;
         }
 
+        // Upload meshes finished by the loader threads, within the frame's budget
+        lvlLoader.update(uploadBudget);
+
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -207,22 +310,68 @@ int main()
 
             ImGui::Begin("Stats"); // Create a window called "Hello, world!" and append into it.
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+            if (lvlLoader.isLoading())
+            {
+                snprintf(label, sizeof(label), "Loading %zu / %zu models", lvlLoader.getLoadedModelCount(), lvlLoader.getModelCount());
+                ImGui::ProgressBar((float)lvlLoader.getLoadedModelCount() / (float)lvlLoader.getModelCount(), ImVec2(-1.0f, 0.0f), label);
+            }
             ImGui::Text("Number of Objects: %d", lvlLoader.getObjects().size());
             ImGui::Text("Number of Lights: %d", lvlLoader.getLights().size());
+            ImGui::Text("Index memory: %.1f KB (%.1f KB saved by 16-bit indices)",
+                        lvlLoader.getIndexBytes() / 1024.0f, lvlLoader.getIndexBytesSaved() / 1024.0f);
+            ImGui::Text("Meshes: %zu unique (%zu cache hits, %zu misses)", lvlLoader.getMeshRegistry().getMeshCount(),
+                        lvlLoader.getMeshRegistry().getHits(), lvlLoader.getMeshRegistry().getMisses());
+            ImGui::Text("Shader programs: %zu unique (%zu compiled in %.1f ms, %zu shared)", lvlLoader.getProgramRegistry().getProgramCount(),
+                        lvlLoader.getProgramRegistry().getCompileCount(), lvlLoader.getProgramRegistry().getCompileSeconds() * 1000.0,
+                        lvlLoader.getProgramRegistry().getHits());
+            if (lvlLoader.getProgramRegistry().getPendingCount() > 0)
+            {
+                ImGui::Text("Shader programs compiling: %zu", lvlLoader.getProgramRegistry().getPendingCount());
+            }
+            ImGui::Text("Program binaries: %zu loaded in %.1f ms, %zu rejected", lvlLoader.getProgramRegistry().getBinaryLoadCount(),
+                        lvlLoader.getProgramRegistry().getBinaryLoadSeconds() * 1000.0, lvlLoader.getProgramRegistry().getBinaryRejectCount());
+            ImGui::Text("Startup: first frame %.1f ms, all models %.1f ms", firstFrameMilliseconds, loadedMilliseconds);
+            ImGui::Text("Resident memory: %.1f MB before meshes, %.1f MB after upload",
+                        lvlLoader.getResidentBeforeUpload() / (1024.0f * 1024.0f), lvlLoader.getResidentAfterUpload() / (1024.0f * 1024.0f));
+            ImGui::Text("Triangles submitted: %zu", trianglesSubmitted);
+            ImGui::Text("Draw calls: %zu (%zu instances)", drawCalls, instancesDrawn);
+            ImGui::Text("Program binds: %zu (%zu skipped), VAO binds: %zu (%zu skipped)", programBinds, programBindsSkipped,
+                        vaoBinds, vaoBindsSkipped);
+            ImGui::Text("Draw list: %zu items, %d radix passes", drawList.size(), drawList.getSortPasses());
+            ImGui::Checkbox("Sort draws by state", &sortDraws);
+            ImGui::Text("Matrices recomputed: %zu", lvlLoader.getSceneGraph().getRecomputedCount());
+            ImGui::Text("Heap allocations per frame: %zu", frameAllocations);
+            ImGui::Text("GL calls per frame: %zu", frameGLCalls);
+            ImGui::Checkbox("Cache uniform locations", &cacheUniforms);
+            ImGui::Checkbox("Use LODs", &useLods);
             ImGui::Separator();
             ImGui::End();
 
             for (int count = 0; count < lvlLoader.getObjects().size(); count++)
             {
                 Object &object = lvlLoader.getObjects()[count];
-                ImGui::Begin(("Object " + std::to_string(count)).c_str());
+                snprintf(label, sizeof(label), "Object %d", count);
+                ImGui::Begin(label);
                 ImGui::Text("Object %d at position: (%.1f, %.1f, %.1f)", count, object.locationX, object.locationY, object.locationZ);
+                if (lvlLoader.getSceneGraph().getParent(object.node) != SceneGraph::NoParent)
+                {
+                    ImGui::Text("Position and angle are relative to the parent");
+                }
                 ImGui::Text("Object %d at Rotation angle: %.1f radians", count, object.angle);
                 ImGui::Text("Object %d Color: (%.1f, %.1f, %.1f)", count, object.color.r, object.color.g, object.color.b);
                 ImGui::Separator();
-                ImGui::SliderFloat3(("Object Location " + std::to_string(count)).c_str(), &object.locationX, -10.0f, 10.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
-                ImGui::SliderFloat(("Object Angle " + std::to_string(count)).c_str(), &object.angle, 0.0f, 6.28f);
-                ImGui::ColorEdit3(("Object Color " + std::to_string(count)).c_str(), (float *)&object.color);
+                // Edited objects and their children get new matrices this frame
+                bool changed = false;
+                snprintf(label, sizeof(label), "Object Location %d", count);
+                changed |= ImGui::SliderFloat3(label, &object.locationX, -10.0f, 10.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
+                snprintf(label, sizeof(label), "Object Angle %d", count);
+                changed |= ImGui::SliderFloat(label, &object.angle, 0.0f, 6.28f);
+                snprintf(label, sizeof(label), "Object Color %d", count);
+                changed |= ImGui::ColorEdit3(label, (float *)&object.color);
+                if (changed)
+                {
+                    lvlLoader.markObjectChanged(count);
+                }
                 ImGui::Separator();
                 ImGui::End();
             }
@@ -231,17 +380,21 @@ int main()
             for (int count = 0; count < lvlLoader.getLights().size(); count++)
             {
                 Light &light = lvlLoader.getLights()[count];
-                ImGui::Begin(("Light " + std::to_string(count)).c_str());
+                snprintf(label, sizeof(label), "Light %d", count);
+                ImGui::Begin(label);
                 ImGui::Text("Light %d at position: (%.1f, %.1f, %.1f)", count, light.position.x, light.position.y, light.position.z);
-                ImGui::SliderFloat3(("Light Position " + std::to_string(count)).c_str(), &light.position.x, -10.0f, 10.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
+                snprintf(label, sizeof(label), "Light Position %d", count);
+                ImGui::SliderFloat3(label, &light.position.x, -10.0f, 10.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
                 //ImGui::End();
                 //ImGui::Begin(("Light Color " + std::to_string(count)).c_str());
                 ImGui::Text("Light %d Color: (%.1f, %.1f, %.1f)", count, light.color.r, light.color.g, light.color.b);
-                ImGui::ColorEdit3(("Light Color " + std::to_string(count)).c_str(), (float *)&light.color);
+                snprintf(label, sizeof(label), "Light Color %d", count);
+                ImGui::ColorEdit3(label, (float *)&light.color);
                 //ImGui::End();
                 //ImGui::Begin(("Light Intensity " + std::to_string(count)).c_str());
                 ImGui::Text("Light %d Intensity: %.1f", count, light.intensity);
-                ImGui::SliderFloat(("Light Intensity " + std::to_string(count)).c_str(), &light.intensity, 0.0f, 10.0f);
+                snprintf(label, sizeof(label), "Light Intensity %d", count);
+                ImGui::SliderFloat(label, &light.intensity, 0.0f, 10.0f);
                 ImGui::End();
             }
         }
@@ -322,54 +475,104 @@ int main()
         // Update view matrix
         view = camera.getLookAt();
 
-        // for each object in the level
-        for (Object object : lvlLoader.getObjects())
-        {
-            // Use the shader program
-            glUseProgram(object.programID);
+        // Uploaded once here instead of to every object's program
+        frameUniforms->update(view, projection, lvlLoader.getLights());
 
-            // Set the view and projection matrices as uniforms in your shader program
-            GLint viewLoc = glGetUniformLocation(object.programID, "view");
-            glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+        // Pick up transform and color edits from the object windows, through
+        // the scene graph so children follow their parents
+        lvlLoader.updateRenderItems();
 
-            GLint projectionLoc = glGetUniformLocation(object.programID, "projection");
-            glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        // Every object with a linked program, keyed by its state and depth
+        const std::vector<RenderItem> &renderItems = lvlLoader.getRenderItems();
+        drawList.clear();
+        drawList.reserve(renderItems.size());
+        for (size_t index = 0; index < renderItems.size(); index++)
+        {
+            const RenderItem &item = renderItems[index];
+            if (!item.uniforms->ready)
+            {
+                continue;
+            }
+            glm::vec4 center = view * (item.model * glm::vec4(item.boundsCenter, 1.0f));
+            drawList.add(makeSortKey(item.programID, item.vao, -center.z, farPlane), (uint32_t)index);
+        }
+        if (sortDraws)
+        {
+            drawList.sort();
+        }
 
-            int lightCount = 0;
-            int numLights = lvlLoader.getLights().size();
-            glUniform1i(glGetUniformLocation(object.programID, "numLights"), numLights);
-            glUniform3fv(glGetUniformLocation(object.programID, "objectColor"), 1, glm::value_ptr(object.color));
+        // Binds are skipped while consecutive items share the state
+        trianglesSubmitted = 0;
+        drawCalls = 0;
+        instancesDrawn = 0;
+        programBinds = 0;
+        programBindsSkipped = 0;
+        vaoBinds = 0;
+        vaoBindsSkipped = 0;
+        GLuint boundProgram = 0;
+        GLuint boundVao = 0;
+        for (const DrawCommand &command : drawList.getCommands())
+        {
+            const RenderItem &item = renderItems[command.item];
+            const ProgramUniforms &uniforms = *item.uniforms;
 
-            for (Light light : lvlLoader.getLights())
+            // Use the shader program
+            if (item.programID != boundProgram)
+            {
+                GL_COUNTED(glUseProgram(item.programID));
+                boundProgram = item.programID;
+                programBinds++;
+            }
+            else
             {
-                // Set light properties as uniforms
-                std::string base = "lights[" + std::to_string(lightCount) + "]";
-                glUniform3fv(glGetUniformLocation(object.programID, (base + ".position").c_str()), 1, glm::value_ptr(light.position));
-                glUniform3fv(glGetUniformLocation(object.programID, (base + ".color").c_str()), 1, glm::value_ptr(light.color));
-
-                // Set object color as uniform
-                glUniform1f(glGetUniformLocation(object.programID, (base + ".intensity").c_str()), light.intensity);
-                lightCount++;
+                programBindsSkipped++;
             }
 
-            // Bind the VAO
-            glBindVertexArray(object.vao);
+            GL_COUNTED(glUniform3fv(uniformLocation(item.programID, uniforms.objectColor, cacheUniforms, "objectColor"), 1, glm::value_ptr(item.color)));
 
-            glm::vec3 myRotationAxis(0.0f, 1.0f, 0.0f);
-            glm::mat4 rotationMatrix = glm::rotate(object.angle, myRotationAxis);
-            glm::vec3 translation(object.locationX, object.locationY, object.locationZ);
-            glm::mat4 translationMatrix = glm::translate(translation);
-            glm::vec3 scale(1.0f, 1.0f, 1.0f);
-            glm::mat4 scaleMatrix = glm::scale(scale);
+            // Bind the VAO
+            if (item.vao != boundVao)
+            {
+                GL_COUNTED(glBindVertexArray(item.vao));
+                boundVao = item.vao;
+                vaoBinds++;
+            }
+            else
+            {
+                vaoBindsSkipped++;
+            }
 
             // Set the transformation matrix
-            GLint modelLoc = glGetUniformLocation(object.programID, "model");
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(translationMatrix * rotationMatrix * scaleMatrix));
+            GLint modelLoc = uniformLocation(item.programID, uniforms.model, cacheUniforms, "model");
+            GL_COUNTED(glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(item.model)));
+            GLint normalLoc = uniformLocation(item.programID, uniforms.normalMatrix, cacheUniforms, "normalMatrix");
+            GL_COUNTED(glUniformMatrix3fv(normalLoc, 1, GL_FALSE, glm::value_ptr(item.normalMatrix)));
 
-            ObjLoader objLoader = object.objLoader;
+            // Quantized positions are unorm16 against the mesh bounds
+            if (item.quantized)
+            {
+                GLint offsetLoc = uniformLocation(item.programID, uniforms.positionOffset, cacheUniforms, "positionOffset");
+                GL_COUNTED(glUniform3fv(offsetLoc, 1, glm::value_ptr(item.positionOffset)));
+                GLint scaleLoc = uniformLocation(item.programID, uniforms.positionScale, cacheUniforms, "positionScale");
+                GL_COUNTED(glUniform3fv(scaleLoc, 1, glm::value_ptr(item.positionScale)));
+            }
 
-            // Draw the object
-            glDrawElements(GL_TRIANGLES, objLoader.getFaces().size() * 3, GL_UNSIGNED_INT, 0);
+            // Draw the level of detail that fits the object's size on screen
+            size_t lod = useLods ? selectLod(item, camera.getPosition(), projectionScale) : 0;
+            if (item.instanceCount > 0)
+            {
+                // Every instance of the entry in one call
+                GL_COUNTED(glDrawElementsInstanced(GL_TRIANGLES, item.lodIndexCount[lod], item.indexType, (void *)item.lodIndexOffset[lod], item.instanceCount));
+                trianglesSubmitted += item.lodIndexCount[lod] / 3 * item.instanceCount;
+                instancesDrawn += item.instanceCount;
+            }
+            else
+            {
+                GL_COUNTED(glDrawElements(GL_TRIANGLES, item.lodIndexCount[lod], item.indexType, (void *)item.lodIndexOffset[lod]));
+                trianglesSubmitted += item.lodIndexCount[lod] / 3;
+                instancesDrawn++;
+            }
+            drawCalls++;
         }
 
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -377,6 +580,53 @@ int main()
         // Swap front and back buffers
         glfwSwapBuffers(window);
 
+        if (firstFrameMilliseconds == 0.0)
+        {
+            firstFrameMilliseconds = millisecondsSince(startupStart);
+        }
+        if (loadedMilliseconds == 0.0 && !lvlLoader.isLoading() && lvlLoader.getProgramRegistry().getPendingCount() == 0)
+        {
+            loadedMilliseconds = millisecondsSince(startupStart);
+            const ProgramRegistry &programs = lvlLoader.getProgramRegistry();
+            fprintf(stderr, "Startup: context %.1f ms, level parsed %.1f ms, first frame %.1f ms, all models %.1f ms\n",
+                    contextMilliseconds, levelMilliseconds, firstFrameMilliseconds, loadedMilliseconds);
+            fprintf(stderr, "Startup programs: %zu compiled in %.1f ms, %zu from the binary cache in %.1f ms, %zu binaries rejected\n",
+                    programs.getCompileCount(), programs.getCompileSeconds() * 1000.0, programs.getBinaryLoadCount(),
+                    programs.getBinaryLoadSeconds() * 1000.0, programs.getBinaryRejectCount());
+        }
+
+        size_t allocations = getAllocationCount();
+        frameAllocations = allocations - frameStartAllocations;
+        frameStartAllocations = allocations;
+
+        size_t glCalls = getGLCallCount();
+        frameGLCalls = glCalls - frameStartGLCalls;
+        frameStartGLCalls = glCalls;
+
+        // The clock starts at the end of the first frame with everything
+        // loaded, so the timed frames draw the whole level
+        if (benchmarkFrames > 0 && loadedMilliseconds != 0.0)
+        {
+            if (measuredFrames == 0)
+            {
+                measureStart = std::chrono::steady_clock::now();
+            }
+            else
+            {
+                measuredDrawCalls += drawCalls;
+                measuredTriangles += trianglesSubmitted;
+                measuredGLCalls += frameGLCalls;
+            }
+            if (measuredFrames++ == benchmarkFrames)
+            {
+                double frames = (double)benchmarkFrames;
+                printf("%s: %zu frames, %.3f ms/frame, %.1f draw calls/frame, %.0f triangles/frame, %.1f GL calls/frame\n",
+                       levelPath, benchmarkFrames, millisecondsSince(measureStart) / frames, measuredDrawCalls / frames,
+                       measuredTriangles / frames, measuredGLCalls / frames);
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+            }
+        }
+
         // Poll for and process events
         // glfwPollEvents();
     }
@@ -387,6 +637,7 @@ int main()
     ImGui::DestroyContext();
 
     lvlLoader.destroyObjects();
+    frameUniforms.reset();
 
     // Close GLFW
     glfwTerminate();
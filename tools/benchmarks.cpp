@@ -0,0 +1,1086 @@
+// Command line benchmarks for the CPU side of the engine. Nothing here needs
+// a window or a GL context, so it can run on build and asset machines.
+//
+// Usage:
+//   Benchmarks parse [file.obj ...] [--triangles N]
+//   Benchmarks parallel [file.obj ...] [--triangles N]
+//   Benchmarks cache [file.obj ...] [--triangles N]
+//   Benchmarks optimize [file.obj ...]
+//   Benchmarks quantize [file.obj ...]
+//   Benchmarks level [file.json] [--models N]
+//   Benchmarks instances [--count N]
+//   Benchmarks transforms [--count N ...]
+//   Benchmarks variants [level.json ...]
+//   Benchmarks sort [--count N ...]
+//   Benchmarks lods [level.json ...]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <thread>
+
+#include <sys/stat.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "../common/vertex.hpp"
+#include "../common/normal.hpp"
+#include "../common/face.hpp"
+#include "../common/objloader.hpp"
+#include "../common/meshbin.hpp"
+#include "../common/meshoptimizer.hpp"
+#include "../common/quantization.hpp"
+#include "../common/lvlparser.hpp"
+#include "../common/lvlbin.hpp"
+#include "../common/memorystats.hpp"
+#include "../common/transformbatch.hpp"
+#include "../common/shadervariants.hpp"
+#include "../common/drawlist.hpp"
+#include "../common/lodselection.hpp"
+#include "../common/light.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static size_t fileSize(const std::string& filePath) {
+    struct stat st;
+    if (stat(filePath.c_str(), &st) != 0) {
+        return 0;
+    }
+    return (size_t)st.st_size;
+}
+
+// Writes a flat grid with per-vertex normals and the requested number of
+// triangles. The file is kept between runs since it takes a while to write.
+static std::string generateGrid(size_t triangles) {
+    std::string filePath = "bench_grid_" + std::to_string(triangles) + ".obj";
+    if (fileSize(filePath) > 0) {
+        return filePath;
+    }
+
+    size_t quads = (triangles + 1) / 2;
+    size_t side = 1;
+    while (side * side < quads) {
+        side++;
+    }
+
+    std::cerr << "Generating " << filePath << " (" << side << "x" << side << " quads)" << std::endl;
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (!file) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return std::string();
+    }
+
+    size_t row = side + 1;
+    for (size_t z = 0; z < row; z++) {
+        for (size_t x = 0; x < row; x++) {
+            fprintf(file, "v %.6f %.6f %.6f\n", (float)x / side - 0.5f, 0.0f, (float)z / side - 0.5f);
+        }
+    }
+    for (size_t i = 0; i < row * row; i++) {
+        fprintf(file, "vn 0.000000 1.000000 0.000000\n");
+    }
+    size_t written = 0;
+    for (size_t z = 0; z < side && written < triangles; z++) {
+        for (size_t x = 0; x < side && written < triangles; x++) {
+            size_t a = z * row + x + 1, b = a + 1, c = a + row, d = c + 1;
+            fprintf(file, "f %zu//%zu %zu//%zu %zu//%zu\n", a, a, c, c, b, b);
+            if (++written < triangles) {
+                fprintf(file, "f %zu//%zu %zu//%zu %zu//%zu\n", b, b, c, c, d, d);
+                written++;
+            }
+        }
+    }
+    fclose(file);
+    return filePath;
+}
+
+static void benchmarkParse(const std::string& filePath) {
+    size_t bytes = fileSize(filePath);
+    if (bytes == 0) {
+        std::cerr << "Skipping missing file: " << filePath << std::endl;
+        return;
+    }
+
+    // Small files finish in microseconds, repeat them for a stable number
+    int runs = bytes < (16 << 20) ? 20 : 1;
+    ObjLoadOptions options;
+    options.useCache = false;
+    // Time the parser alone, the vertex cache and fetch passes are serial
+    options.optimize = false;
+    double best = 0.0;
+    size_t faces = 0;
+    for (int i = 0; i < runs; i++) {
+        Clock::time_point start = Clock::now();
+        ObjLoader objLoader(filePath, options);
+        double ms = elapsedMs(start);
+        faces = objLoader.getFaceCount();
+        if (i == 0 || ms < best) {
+            best = ms;
+        }
+    }
+
+    double megabytes = bytes / (1024.0 * 1024.0);
+    printf("%-32s %10.2f MB %10zu faces %10.2f ms %10.1f MB/s\n",
+        filePath.c_str(), megabytes, faces, best, megabytes / (best / 1000.0));
+}
+
+static int runParse(int argc, char** argv) {
+    std::vector<std::string> files;
+    size_t triangles = 10000000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) {
+            triangles = strtoull(argv[++i], nullptr, 10);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        files.push_back("../teapot.obj");
+        files.push_back(generateGrid(triangles));
+    }
+
+    for (const std::string& file : files) {
+        benchmarkParse(file);
+    }
+    return 0;
+}
+
+template <typename T>
+static bool sameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// Writes small patches that each declare their own vertices and index them
+// with negative (relative) indices, with the vertex runs interrupted by
+// faces, some faces reaching back into the previous patch and some using
+// absolute indices. About 40 MB, so chunk boundaries fall inside vertex
+// runs and relative indices cross them.
+static std::string generateRelativeMesh() {
+    const size_t patches = 80000;
+    std::string filePath = "bench_relative_" + std::to_string(patches) + ".obj";
+    if (fileSize(filePath) > 0) {
+        return filePath;
+    }
+
+    std::cerr << "Generating " << filePath << std::endl;
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (!file) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return std::string();
+    }
+
+    for (size_t p = 0; p < patches; p++) {
+        float x = (float)(p % 400);
+        float z = (float)(p / 400);
+        float tilt = (float)(p % 17) / 17.0f;
+        for (int i = 0; i < 4; i++) {
+            fprintf(file, "v %.6f %.6f %.6f\n", x + (i & 1), tilt * i, z + (i >> 1));
+            fprintf(file, "vn %.6f %.6f %.6f\n", tilt, 1.0f, (float)i / 4.0f);
+        }
+        fprintf(file, "f -4//-4 -3//-3 -2//-2\n");
+        fprintf(file, "f -3//-3 -1//-1 -2//-2\n");
+
+        // The patch's vertex run continues after its faces
+        for (int i = 0; i < 2; i++) {
+            fprintf(file, "v %.6f %.6f %.6f\n", x + 2.0f, tilt, z + i);
+            fprintf(file, "vn %.6f %.6f %.6f\n", 1.0f, tilt, 0.0f);
+        }
+        fprintf(file, "f -5//-5 -2//-2 -3//-3\n");
+        fprintf(file, "f -5//-5 -1//-1 -2//-2\n");
+
+        // Back into the previous patch, six vertices per patch
+        if (p > 0 && p % 3 == 0) {
+            fprintf(file, "f -8//-8 -6//-6 -1//-1\n");
+        }
+        // Absolute indices into the first patch
+        if (p % 7 == 0) {
+            fprintf(file, "f 1//1 2//2 -1//-1\n");
+        }
+    }
+    fclose(file);
+    return filePath;
+}
+
+// Times the serial parse against the chunked parse at increasing thread
+// counts. Every parallel result must match the serial one byte for byte.
+// Splits are checked up to 8 chunks even on machines with fewer threads.
+static bool benchmarkParallel(const std::string& filePath) {
+    // Parse only, the optimizer would dominate both columns
+    ObjLoadOptions serialOptions;
+    serialOptions.parallel = false;
+    serialOptions.useCache = false;
+    serialOptions.optimize = false;
+    Clock::time_point start = Clock::now();
+    ObjLoader serial(filePath, serialOptions);
+    double serialMs = elapsedMs(start);
+
+    double megabytes = fileSize(filePath) / (1024.0 * 1024.0);
+    printf("%s: %zu faces\n", filePath.c_str(), serial.getFaceCount());
+    printf("%-8s %10.2f ms %10.1f MB/s\n", "serial", serialMs, megabytes / (serialMs / 1000.0));
+
+    unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 8u);
+
+    bool identical = true;
+    for (unsigned int threads = 1; ; threads *= 2) {
+        if (threads > maxThreads) threads = maxThreads;
+
+        ObjLoadOptions options;
+        options.threads = threads;
+        options.useCache = false;
+        options.optimize = false;
+        start = Clock::now();
+        ObjLoader parallel(filePath, options);
+        double ms = elapsedMs(start);
+
+        bool same = sameBytes(serial.getVertices(), parallel.getVertices())
+            && sameBytes(serial.getVertexNormals(), parallel.getVertexNormals())
+            && sameBytes(serial.getFaces(), parallel.getFaces());
+        identical = identical && same;
+
+        printf("%2u %-5s %10.2f ms %10.1f MB/s %6.2fx %s\n", threads, threads == 1 ? "thread" : "threads",
+            ms, megabytes / (ms / 1000.0), serialMs / ms, same ? "identical" : "MISMATCH");
+
+        if (threads == maxThreads) break;
+    }
+    return identical;
+}
+
+static int runParallel(int argc, char** argv) {
+    std::vector<std::string> files;
+    size_t triangles = 10000000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) {
+            triangles = strtoull(argv[++i], nullptr, 10);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        files.push_back(generateGrid(triangles));
+        files.push_back(generateRelativeMesh());
+    }
+
+    bool identical = true;
+    for (const std::string& filePath : files) {
+        identical = benchmarkParallel(filePath) && identical;
+    }
+    return identical ? 0 : 1;
+}
+
+// Startup cost of a mesh from text, cold (parse and write the sidecar) and
+// warm (map the sidecar). The warm arrays must match the parsed ones.
+static bool benchmarkCache(const std::string& filePath) {
+    if (fileSize(filePath) == 0) {
+        std::cerr << "Skipping missing file: " << filePath << std::endl;
+        return true;
+    }
+    remove(meshBinPath(filePath, VertexFormatFloat, std::vector<float>()).c_str());
+
+    ObjLoadOptions textOptions;
+    textOptions.useCache = false;
+    Clock::time_point start = Clock::now();
+    ObjLoader text(filePath, textOptions);
+    double textMs = elapsedMs(start);
+
+    start = Clock::now();
+    ObjLoader cold(filePath);
+    double coldMs = elapsedMs(start);
+
+    start = Clock::now();
+    ObjLoader warm(filePath);
+    double warmMs = elapsedMs(start);
+
+    bool same = warm.isCached()
+        && warm.getVertexCount() == text.getVertexCount()
+        && warm.getFaceCount() == text.getFaceCount()
+        && memcmp(warm.getVertexData(), text.getVertexData(), text.getVertexCount() * vertexStride(text.getVertexFormat())) == 0
+        && warm.getIndexSize() == text.getIndexSize()
+        && memcmp(warm.getIndexData(), text.getIndexData(), text.getFaceCount() * 3 * text.getIndexSize()) == 0;
+
+    printf("%-32s text %9.2f ms  cold %9.2f ms  warm %9.2f ms  %7.1fx %s\n", filePath.c_str(),
+        textMs, coldMs, warmMs, textMs / warmMs, same ? "identical" : "MISMATCH");
+    return same;
+}
+
+static int runCache(int argc, char** argv) {
+    std::vector<std::string> files;
+    size_t triangles = 10000000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) {
+            triangles = strtoull(argv[++i], nullptr, 10);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        files.push_back("../teapot.obj");
+        files.push_back("../cube-test.obj");
+        files.push_back(generateGrid(triangles));
+    }
+
+    bool identical = true;
+    for (const std::string& file : files) {
+        identical = benchmarkCache(file) && identical;
+    }
+    return identical ? 0 : 1;
+}
+
+// Vertex cache efficiency of the authoring order against the optimized
+// order, from the CPU cache simulator at a few common cache sizes
+static int runOptimize(int argc, char** argv) {
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        files.push_back("../teapot.obj");
+        files.push_back("../cube-test.obj");
+    }
+
+    for (const std::string& filePath : files) {
+        ObjLoadOptions options;
+        options.useCache = false;
+        options.optimize = false;
+        ObjLoader objLoader(filePath, options);
+        std::vector<Vertex> vertices = objLoader.getVertices();
+        std::vector<Face> faces = objLoader.getFaces();
+
+        Clock::time_point start = Clock::now();
+        std::vector<Face> optimized = faces;
+        optimizeVertexCache(optimized, vertices.size());
+        optimizeVertexFetch(vertices, optimized);
+        double ms = elapsedMs(start);
+
+        printf("%s (%zu faces, %zu vertices, optimized in %.2f ms)\n", filePath.c_str(), faces.size(), vertices.size(), ms);
+        const unsigned int cacheSizes[] = { 8, 16, 32 };
+        for (unsigned int cacheSize : cacheSizes) {
+            VertexCacheStats before = analyzeVertexCache(faces.data(), faces.size(), vertices.size(), cacheSize);
+            VertexCacheStats after = analyzeVertexCache(optimized.data(), optimized.size(), vertices.size(), cacheSize);
+            printf("  cache %2u  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", cacheSize, before.acmr, after.acmr, before.atvr, after.atvr);
+        }
+    }
+    return 0;
+}
+
+// Round trips every vertex through PackedVertex and checks the error stays
+// within half a quantization step per axis and a small normal angle
+static int runQuantize(int argc, char** argv) {
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        files.push_back("../teapot.obj");
+        files.push_back("../cube-test.obj");
+    }
+
+    const float maxNormalDegrees = 0.01f;
+    bool withinBounds = true;
+    for (const std::string& filePath : files) {
+        ObjLoadOptions options;
+        options.useCache = false;
+        ObjLoader objLoader(filePath, options);
+        const std::vector<Vertex>& vertices = objLoader.getVertices();
+        const Bounds& bounds = objLoader.getBounds();
+
+        float maxPositionError[3] = { 0.0f, 0.0f, 0.0f };
+        float maxAngle = 0.0f;
+        bool ok = true;
+        for (const Vertex& vertex : vertices) {
+            Vertex decoded = unpackVertex(packVertex(vertex, bounds), bounds);
+            const float original[3] = { vertex.x, vertex.y, vertex.z };
+            const float result[3] = { decoded.x, decoded.y, decoded.z };
+            for (int axis = 0; axis < 3; axis++) {
+                float error = fabsf(original[axis] - result[axis]);
+                float step = (bounds.max[axis] - bounds.min[axis]) / 65535.0f;
+                maxPositionError[axis] = std::max(maxPositionError[axis], error);
+                ok = ok && error <= step * 0.5f + 1e-6f;
+            }
+
+            // acos is too coarse near 1 in float precision, use the cross product
+            double length = sqrt((double)vertex.nX * vertex.nX + (double)vertex.nY * vertex.nY + (double)vertex.nZ * vertex.nZ);
+            if (length > 0.0) {
+                double cx = (double)vertex.nY * decoded.nZ - (double)vertex.nZ * decoded.nY;
+                double cy = (double)vertex.nZ * decoded.nX - (double)vertex.nX * decoded.nZ;
+                double cz = (double)vertex.nX * decoded.nY - (double)vertex.nY * decoded.nX;
+                double dot = (double)vertex.nX * decoded.nX + (double)vertex.nY * decoded.nY + (double)vertex.nZ * decoded.nZ;
+                float angle = (float)(atan2(sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / 3.14159265358979);
+                maxAngle = std::max(maxAngle, angle);
+            }
+        }
+        ok = ok && maxAngle <= maxNormalDegrees;
+        withinBounds = withinBounds && ok;
+
+        size_t floatBytes = vertices.size() * sizeof(Vertex);
+        size_t packedBytes = vertices.size() * sizeof(PackedVertex);
+        printf("%s: %zu vertices, %zu -> %zu bytes (%.0f%% saved)\n", filePath.c_str(), vertices.size(),
+            floatBytes, packedBytes, 100.0 * (floatBytes - packedBytes) / std::max<size_t>(floatBytes, 1));
+        printf("  max position error (%g, %g, %g), max normal error %.5f degrees %s\n",
+            maxPositionError[0], maxPositionError[1], maxPositionError[2], maxAngle, ok ? "ok" : "OUT OF BOUNDS");
+    }
+    return withinBounds ? 0 : 1;
+}
+
+// Writes a level with the requested number of model entries spread over a
+// grid, cycling through the example meshes. Kept between runs like the grids.
+static std::string generateLevel(size_t models) {
+    std::string filePath = "bench_level_" + std::to_string(models) + ".json";
+    if (fileSize(filePath) > 0) {
+        return filePath;
+    }
+
+    std::cerr << "Generating " << filePath << std::endl;
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (!file) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return std::string();
+    }
+
+    static const char* meshes[] = { "../teapot.obj", "../cube-test.obj", "../cube.obj" };
+    size_t side = (size_t)std::ceil(std::sqrt((double)models));
+    fprintf(file, "{\n  \"Name\": \"Bench_Level_%zu\",\n  \"Description\": \"\",\n", models);
+    fprintf(file, "  \"Lights\": [\n    { \"Position\": [0.0, 3.0, 2.0], \"Color\": [1.0, 1.0, 1.0], \"Intensity\": 0.5 }\n  ],\n");
+    fprintf(file, "  \"Models\": [\n");
+    for (size_t i = 0; i < models; i++) {
+        fprintf(file, "    { \"FileName\": \"%s\", \"VertexShader\": \"../SimpleVertexShader.glsl\", "
+                      "\"FragmentShader\": \"../SimpleFragmentShader.glsl\", \"LocationX\": %.1f, \"LocationY\": 0.0, "
+                      "\"LocationZ\": %.1f, \"Angle\": %.2f, \"Color\": [%.2f, 0.5, 0.5], \"LoadObject\": true }%s\n",
+            meshes[i % 3], (double)(i % side) * 3.0, (double)(i / side) * 3.0, (double)(i % 628) / 100.0,
+            (double)(i % 100) / 100.0, i + 1 < models ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return filePath;
+}
+
+// Counts records and folds every field into a checksum, so both parsers
+// can be checked against each other without keeping the records
+class LevelChecksum : public LevelSink {
+public:
+    LevelChecksum() : lights(0), models(0), instances(0), checksum(0.0) {}
+
+    size_t lights;
+    size_t models;
+    size_t instances;
+    double checksum;
+
+    void onName(const std::string& name) {
+        checksum += name.size();
+    }
+
+    // Cooked levels apply the retention per model instead
+    void onMeshRetention(MeshRetention) {
+    }
+
+    void onLight(const Light& light) {
+        lights++;
+        checksum += light.position.x + light.position.y + light.position.z + light.color.r + light.intensity;
+    }
+
+    void onModel(const LevelModel& model) {
+        models++;
+        checksum += model.name.size() + model.parent.size() + model.fileName.size() + model.vertexShader.size() + model.fragmentShader.size()
+            + model.x + model.y + model.z + model.angle + model.color.r + model.color.g + model.color.b
+            + model.load + model.options.lodRatios.size();
+        for (const LevelInstance& instance : model.instances) {
+            instances++;
+            checksum += instance.x + instance.y + instance.z + instance.angle + instance.color.r;
+        }
+    }
+};
+
+static bool cookLevel(const std::string& filePath, const std::string& cookedPath) {
+    LevelData level;
+    if (!parseLevel(filePath, level)) {
+        return false;
+    }
+    level.applyRetention();
+    if (!writeLevelBin(cookedPath, level.name, level.models, level.lights)) {
+        return false;
+    }
+    printf("%s: %.2f MB\n", cookedPath.c_str(), fileSize(cookedPath) / (1024.0 * 1024.0));
+    return true;
+}
+
+// Load time and peak memory of the streaming SAX parser against the DOM
+// parser and the cooked .lvlbin. SAX runs first so its peak is not hidden
+// by the DOM's.
+static int runLevel(int argc, char** argv) {
+    std::string filePath;
+    size_t models = 200000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--models") == 0 && i + 1 < argc) {
+            models = strtoull(argv[++i], nullptr, 10);
+        } else {
+            filePath = argv[i];
+        }
+    }
+    if (filePath.empty()) {
+        filePath = generateLevel(models);
+    }
+    size_t bytes = fileSize(filePath);
+    if (bytes == 0) {
+        std::cerr << "Skipping missing file: " << filePath << std::endl;
+        return 1;
+    }
+
+    printf("%s: %.2f MB\n", filePath.c_str(), bytes / (1024.0 * 1024.0));
+    std::string cookedPath = filePath.substr(0, filePath.find_last_of('.')) + ".lvlbin";
+    LevelChecksum results[3];
+    const char* names[3] = { "SAX", "DOM", "BIN" };
+    for (int i = 0; i < 3; i++) {
+        // Cooked after the text parsers ran, so their peaks are measured first
+        if (i == 2 && !cookLevel(filePath, cookedPath)) {
+            return 1;
+        }
+
+        size_t peakBefore = getPeakResidentBytes();
+        Clock::time_point start = Clock::now();
+        bool ok = i == 0 ? parseLevel(filePath, results[i])
+            : i == 1 ? parseLevelDom(filePath, results[i])
+            : loadLevelBin(cookedPath, results[i]);
+        double ms = elapsedMs(start);
+        size_t peakGrowth = getPeakResidentBytes() - peakBefore;
+        if (!ok) {
+            return 1;
+        }
+        printf("%s %10zu models %10.2f ms  peak memory +%.1f MB\n", names[i], results[i].models, ms,
+            peakGrowth / (1024.0 * 1024.0));
+    }
+
+    bool same = true;
+    for (int i = 1; i < 3; i++) {
+        same = same && results[0].models == results[i].models && results[0].lights == results[i].lights
+            && results[0].instances == results[i].instances
+            && results[0].checksum == results[i].checksum;
+    }
+    printf("SAX, DOM and BIN records %s\n", same ? "match" : "DIFFER");
+    return same ? 0 : 1;
+}
+
+// Writes the same teapot grid either as one instanced model entry or as
+// one entry per teapot. Kept between runs like the other generated files.
+static std::string generateInstances(size_t count, bool instanced) {
+    std::string filePath = std::string(instanced ? "bench_instances_" : "bench_separate_") + std::to_string(count) + ".json";
+    if (fileSize(filePath) > 0) {
+        return filePath;
+    }
+
+    std::cerr << "Generating " << filePath << std::endl;
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (!file) {
+        std::cerr << "Error opening file: " << filePath << std::endl;
+        return std::string();
+    }
+
+    size_t side = (size_t)std::ceil(std::sqrt((double)count));
+    fprintf(file, "{\n  \"Name\": \"Bench_%s_%zu\",\n  \"Description\": \"\",\n", instanced ? "Instances" : "Separate", count);
+    fprintf(file, "  \"Lights\": [\n    { \"Position\": [0.0, 3.0, 2.0], \"Color\": [1.0, 1.0, 1.0], \"Intensity\": 0.5 }\n  ],\n");
+    fprintf(file, "  \"Models\": [\n");
+    if (instanced) {
+        fprintf(file, "    { \"FileName\": \"../teapot.obj\", \"VertexShader\": \"../SimpleVertexShader.glsl\", "
+                      "\"FragmentShader\": \"../SimpleFragmentShader.glsl\", \"LocationX\": 0.0, \"LocationY\": 0.0, "
+                      "\"LocationZ\": 0.0, \"Angle\": 0.0, \"Color\": [1.0, 1.0, 1.0], \"LoadObject\": true,\n");
+        fprintf(file, "      \"Instances\": [\n");
+    }
+    for (size_t i = 0; i < count; i++) {
+        double x = (double)(i % side) * 3.0;
+        double z = (double)(i / side) * 3.0;
+        double angle = (double)(i % 628) / 100.0;
+        double red = (double)(i % 100) / 100.0;
+        const char* separator = i + 1 < count ? "," : "";
+        if (instanced) {
+            fprintf(file, "        { \"Location\": [%.1f, 0.0, %.1f], \"Angle\": %.2f, \"Color\": [%.2f, 0.5, 0.5] }%s\n",
+                x, z, angle, red, separator);
+        } else {
+            fprintf(file, "    { \"FileName\": \"../teapot.obj\", \"VertexShader\": \"../SimpleVertexShader.glsl\", "
+                          "\"FragmentShader\": \"../SimpleFragmentShader.glsl\", \"LocationX\": %.1f, \"LocationY\": 0.0, "
+                          "\"LocationZ\": %.1f, \"Angle\": %.2f, \"Color\": [%.2f, 0.5, 0.5], \"LoadObject\": true }%s\n",
+                x, z, angle, red, separator);
+        }
+    }
+    if (instanced) {
+        fprintf(file, "      ]\n    }\n");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return filePath;
+}
+
+// Writes N teapots as separate model entries and as one instanced entry,
+// and checks that both parse to N teapots. Draw calls and frame time need
+// a GL context: "OpenGL_Test level.json --frames N" measures them, the
+// command for each level is printed.
+static int runInstances(int argc, char** argv) {
+    size_t count = 100000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = strtoull(argv[++i], nullptr, 10);
+        }
+    }
+
+    // mat4 model plus vec3 color, as laid out by InstanceBuffer
+    const size_t instanceBytes = 16 * sizeof(float) + 3 * sizeof(float);
+    const char* names[2] = { "separate", "instanced" };
+    for (int i = 0; i < 2; i++) {
+        bool instanced = i == 1;
+        std::string filePath = generateInstances(count, instanced);
+        if (filePath.empty()) {
+            return 1;
+        }
+
+        LevelChecksum level;
+        Clock::time_point start = Clock::now();
+        if (!parseLevel(filePath, level)) {
+            return 1;
+        }
+        double ms = elapsedMs(start);
+        size_t objects = instanced ? level.instances : level.models;
+        if (objects != count) {
+            std::cerr << filePath << ": expected " << count << " teapots, parsed " << objects << std::endl;
+            return 1;
+        }
+
+        size_t bufferBytes = level.instances * instanceBytes;
+        printf("%-9s %s: %.2f MB, parsed in %.2f ms\n", names[i], filePath.c_str(),
+            fileSize(filePath) / (1024.0 * 1024.0), ms);
+        printf("  %zu model entries, %zu instances, %.2f MB instance buffer\n",
+            level.models, level.instances, bufferBytes / (1024.0 * 1024.0));
+        printf("  measure: ./OpenGL_Test %s --frames 300\n", filePath.c_str());
+    }
+    return 0;
+}
+
+// Best of several runs, in nanoseconds per object
+template <typename Function>
+static double nanosecondsPerObject(size_t count, Function function) {
+    size_t runs = std::max<size_t>(3, 10000000 / std::max<size_t>(count, 1));
+    double best = 0.0;
+    for (size_t run = 0; run < runs; run++) {
+        Clock::time_point start = Clock::now();
+        function();
+        double ms = elapsedMs(start);
+        best = run == 0 ? ms : std::min(best, ms);
+    }
+    return best * 1e6 / std::max<size_t>(count, 1);
+}
+
+static float maxDifference(const float* a, const float* b, size_t count) {
+    float difference = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        difference = std::max(difference, std::fabs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+// Per-object glm::translate * glm::rotate * glm::scale, as Object does,
+// against the batched structure-of-arrays kernel writing model and normal
+// matrices. The glm normal matrix is transpose(inverse(mat3(model))), the
+// same as the vertex shader computes.
+static int runTransforms(int argc, char** argv) {
+    std::vector<size_t> counts;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            counts.push_back(strtoull(argv[++i], nullptr, 10));
+        }
+    }
+    if (counts.empty()) {
+        counts.push_back(1000);
+        counts.push_back(100000);
+        counts.push_back(1000000);
+    }
+
+    printf("SIMD kernel: %s\n", hasSimdTransforms() ? "SSE" : "none, scalar fallback");
+    bool allMatch = true;
+    for (size_t count : counts) {
+        std::vector<float> locationX(count), locationY(count), locationZ(count), angle(count), scale(count);
+        TransformArrays transforms;
+        transforms.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            locationX[i] = (float)(i % 1000) * 3.0f;
+            locationY[i] = (float)(i % 7) - 3.0f;
+            locationZ[i] = (float)(i / 1000) * -3.0f;
+            angle[i] = (float)(i % 628) / 100.0f;
+            scale[i] = 0.5f + (float)(i % 5) * 0.25f;
+            transforms.set(i, locationX[i], locationY[i], locationZ[i], angle[i], scale[i]);
+        }
+
+        std::vector<glm::mat4> glmModels(count);
+        std::vector<glm::mat3> glmNormals(count);
+        const glm::vec3 axis(0.0f, 1.0f, 0.0f);
+        double glmModel = nanosecondsPerObject(count, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                glmModels[i] = glm::translate(glm::vec3(locationX[i], locationY[i], locationZ[i]))
+                    * glm::rotate(angle[i], axis) * glm::scale(glm::vec3(scale[i]));
+            }
+        });
+        double glmBoth = nanosecondsPerObject(count, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                glmModels[i] = glm::translate(glm::vec3(locationX[i], locationY[i], locationZ[i]))
+                    * glm::rotate(angle[i], axis) * glm::scale(glm::vec3(scale[i]));
+                glmNormals[i] = glm::transpose(glm::inverse(glm::mat3(glmModels[i])));
+            }
+        });
+
+        std::vector<float> models(count * ModelMatrixFloats);
+        std::vector<float> normals(count * NormalMatrixFloats);
+        double scalar = nanosecondsPerObject(count, [&]() {
+            composeTransformsScalar(transforms, 0, count, models.data(), normals.data());
+        });
+        double batched = nanosecondsPerObject(count, [&]() {
+            composeTransforms(transforms, 0, count, models.data(), normals.data());
+        });
+
+        // Both paths must agree with glm
+        float modelError = maxDifference(models.data(), &glmModels[0][0][0], count * ModelMatrixFloats);
+        float normalError = 0.0f;
+        for (size_t i = 0; i < count; i++) {
+            for (int column = 0; column < 3; column++) {
+                for (int row = 0; row < 3; row++) {
+                    float difference = std::fabs(normals[i * NormalMatrixFloats + column * 4 + row] - glmNormals[i][column][row]);
+                    normalError = std::max(normalError, difference);
+                }
+            }
+        }
+        std::vector<float> reference(count * ModelMatrixFloats);
+        composeTransformsScalar(transforms, 0, count, reference.data(), nullptr);
+        bool match = modelError < 1e-3f && normalError < 1e-3f
+            && maxDifference(models.data(), reference.data(), reference.size()) == 0.0f;
+        allMatch = allMatch && match;
+
+        printf("%8zu objects  glm model %6.2f ns  glm model+normal %6.2f ns  SoA scalar %6.2f ns  SoA batched %6.2f ns  (%.1fx, %.1fx)  %s\n",
+            count, glmModel, glmBoth, scalar, batched, glmModel / batched, glmBoth / batched, match ? "match" : "DIFFER");
+    }
+    return allMatch ? 0 : 1;
+}
+
+// Variants Level_01.json compiles: all three models share one shader pair
+// and the level has four lights
+static const char* const level01Variants[] = {
+    "../SimpleVertexShader.glsl + ../SimpleFragmentShader.glsl { NUM_LIGHTS 4; }",
+};
+
+// Lists the shader variants a level compiles, the same selection
+// LvlLoader makes, against every permutation its shaders declare.
+// Level_01.json must compile exactly level01Variants.
+static int runVariants(int argc, char** argv) {
+    std::vector<std::string> files(argv, argv + argc);
+    if (files.empty()) {
+        files.push_back("../Level_01.json");
+    }
+    for (const std::string& filePath : files) {
+        LevelData level;
+        bool parsed = isLevelBinPath(filePath) ? loadLevelBin(filePath, level) : parseLevel(filePath, level);
+        if (!parsed) {
+            return 1;
+        }
+
+        ShaderVariants variants;
+        VariantFeatures features;
+        features.lightCount = std::min((int)level.lights.size(), MaxLights);
+        std::map<std::string, size_t> used;
+        std::map<std::string, size_t> declared;
+        size_t loaded = 0;
+        for (const LevelModel& model : level.models) {
+            if (!model.load) {
+                continue;
+            }
+            loaded++;
+            features.quantized = model.options.vertexFormat == VertexFormatQuantized;
+            features.instanced = !model.instances.empty();
+            std::string variant = model.vertexShader + " + " + model.fragmentShader + " {";
+            for (const std::string& define : variants.select(model.vertexShader, model.fragmentShader, features)) {
+                variant += " " + define + ";";
+            }
+            used[variant + " }"]++;
+            declared[model.vertexShader + " + " + model.fragmentShader] = variants.countPermutations(model.vertexShader, model.fragmentShader);
+        }
+
+        printf("%s: %zu models, %zu lights, %zu variants\n", filePath.c_str(), loaded, level.lights.size(), used.size());
+        for (const auto& variant : used) {
+            printf("  %6zu models  %s\n", variant.second, variant.first.c_str());
+        }
+        for (const auto& pair : declared) {
+            printf("  %s declares %zu permutations\n", pair.first.c_str(), pair.second);
+        }
+
+        size_t slash = filePath.find_last_of('/');
+        if (filePath.substr(slash == std::string::npos ? 0 : slash + 1) == "Level_01.json") {
+            std::set<std::string> expected(std::begin(level01Variants), std::end(level01Variants));
+            std::set<std::string> actual;
+            for (const auto& variant : used) {
+                actual.insert(variant.first);
+            }
+            if (actual != expected) {
+                for (const std::string& variant : expected) {
+                    if (!actual.count(variant)) {
+                        printf("  missing expected variant %s\n", variant.c_str());
+                    }
+                }
+                for (const std::string& variant : actual) {
+                    if (!expected.count(variant)) {
+                        printf("  unexpected variant %s\n", variant.c_str());
+                    }
+                }
+                return 1;
+            }
+            printf("  variants match the expected list\n");
+        }
+    }
+    return 0;
+}
+
+// Program and VAO binds a submission in this order makes, skipping binds of
+// the state that is already current
+static size_t countBinds(const std::vector<DrawCommand>& commands, const std::vector<uint32_t>& programs,
+                         const std::vector<uint32_t>& vaos) {
+    size_t binds = 0;
+    uint32_t program = 0;
+    uint32_t vao = 0;
+    for (const DrawCommand& command : commands) {
+        binds += programs[command.item] != program;
+        binds += vaos[command.item] != vao;
+        program = programs[command.item];
+        vao = vaos[command.item];
+    }
+    return binds;
+}
+
+// DrawList's radix sort against std::stable_sort on draw keys spread over
+// a few programs, a few hundred VAOs and random depths, as a stress level
+// produces. Both include filling the list, the orders must be identical.
+static int runSort(int argc, char** argv) {
+    std::vector<size_t> counts;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            counts.push_back(strtoull(argv[++i], nullptr, 10));
+        }
+    }
+    if (counts.empty()) {
+        counts.push_back(1000);
+        counts.push_back(100000);
+        counts.push_back(1000000);
+    }
+
+    bool allMatch = true;
+    for (size_t count : counts) {
+        std::vector<uint64_t> keys(count);
+        std::vector<uint32_t> programs(count);
+        std::vector<uint32_t> vaos(count);
+        uint64_t state = 1;
+        for (size_t i = 0; i < count; i++) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            programs[i] = 3 + (uint32_t)(state >> 61);
+            vaos[i] = 1 + (uint32_t)((state >> 40) % 300);
+            float depth = (float)((state >> 11) & 0xFFFFF) / (float)0xFFFFF * 100.0f;
+            keys[i] = makeSortKey(programs[i], vaos[i], depth, 100.0f);
+        }
+
+        DrawList list;
+        list.reserve(count);
+        double radix = nanosecondsPerObject(count, [&]() {
+            list.clear();
+            for (size_t i = 0; i < count; i++) {
+                list.add(keys[i], (uint32_t)i);
+            }
+            list.sort();
+        });
+
+        std::vector<DrawCommand> reference(count);
+        double stable = nanosecondsPerObject(count, [&]() {
+            for (size_t i = 0; i < count; i++) {
+                reference[i].key = keys[i];
+                reference[i].item = (uint32_t)i;
+            }
+            std::stable_sort(reference.begin(), reference.end(), [](const DrawCommand& a, const DrawCommand& b) {
+                return a.key < b.key;
+            });
+        });
+
+        const std::vector<DrawCommand>& sorted = list.getCommands();
+        bool match = sorted.size() == reference.size();
+        for (size_t i = 0; match && i < count; i++) {
+            match = sorted[i].key == reference[i].key && sorted[i].item == reference[i].item;
+        }
+        allMatch = allMatch && match;
+
+        std::vector<DrawCommand> unsorted(count);
+        for (size_t i = 0; i < count; i++) {
+            unsorted[i].key = keys[i];
+            unsorted[i].item = (uint32_t)i;
+        }
+        size_t bindsBefore = countBinds(unsorted, programs, vaos);
+        size_t bindsAfter = countBinds(sorted, programs, vaos);
+
+        printf("%8zu items  radix %6.2f ns (%6.1f M items/s, %d passes)  std::stable_sort %6.2f ns (%.1fx)  binds %zu -> %zu  %s\n",
+            count, radix, 1e3 / radix, list.getSortPasses(), stable, stable / radix, bindsBefore, bindsAfter,
+            match ? "match" : "DIFFER");
+    }
+    return allMatch ? 0 : 1;
+}
+
+// Triangles one frame submits with every model at full detail and with the
+// level of detail the draw loop picks, from OpenGL_Test's starting camera.
+// Model transforms are taken as world transforms, LevelGen writes no
+// parents. Generate a level to compare with "LevelGen --lods 0.5,0.25,0.1".
+static int runLods(int argc, char** argv) {
+    std::vector<std::string> files(argv, argv + argc);
+    if (files.empty()) {
+        files.push_back("../Level_01.json");
+    }
+    const glm::vec3 cameraPosition(0.0f, 0.0f, 6.0f);
+    const float projectionScale = 1.0f / tanf(glm::radians(60.0f) * 0.5f);
+
+    for (const std::string& filePath : files) {
+        LevelData level;
+        bool parsed = isLevelBinPath(filePath) ? loadLevelBin(filePath, level) : parseLevel(filePath, level);
+        if (!parsed) {
+            return 1;
+        }
+
+        // One loader per file and LOD set, like the mesh registry
+        std::map<std::string, std::shared_ptr<ObjLoader>> meshes;
+        size_t objects = 0;
+        size_t fullTriangles = 0;
+        size_t lodTriangles = 0;
+        std::vector<size_t> objectsPerLod(MaxMeshLods, 0);
+        for (const LevelModel& model : level.models) {
+            if (!model.load) {
+                continue;
+            }
+            std::string key = model.fileName;
+            for (float ratio : model.options.lodRatios) {
+                key += " " + std::to_string(ratio);
+            }
+            std::shared_ptr<ObjLoader>& loader = meshes[key];
+            if (!loader) {
+                loader.reset(new ObjLoader(model.fileName, model.options));
+            }
+            if (loader->getLodCount() == 0) {
+                std::cerr << "Error loading mesh: " << model.fileName << std::endl;
+                return 1;
+            }
+
+            const Bounds& bounds = loader->getBounds();
+            glm::vec3 minimum(bounds.min[0], bounds.min[1], bounds.min[2]);
+            glm::vec3 maximum(bounds.max[0], bounds.max[1], bounds.max[2]);
+            glm::vec3 center = (minimum + maximum) * 0.5f;
+            float radius = glm::length(maximum - minimum) * 0.5f;
+            size_t count = 1;
+
+            // Instanced entries pick one level for the group, from the
+            // same bounds InstanceBuffer computes
+            if (!model.instances.empty()) {
+                glm::vec3 lower(0.0f);
+                glm::vec3 upper(0.0f);
+                for (size_t i = 0; i < model.instances.size(); i++) {
+                    const LevelInstance& instance = model.instances[i];
+                    glm::mat4 instanceMatrix = glm::translate(glm::vec3(instance.x, instance.y, instance.z))
+                        * glm::rotate(instance.angle, glm::vec3(0.0f, 1.0f, 0.0f));
+                    glm::vec3 instanceCenter = glm::vec3(instanceMatrix * glm::vec4(center, 1.0f));
+                    lower = i == 0 ? instanceCenter : glm::min(lower, instanceCenter);
+                    upper = i == 0 ? instanceCenter : glm::max(upper, instanceCenter);
+                }
+                center = (lower + upper) * 0.5f;
+                radius += glm::length(upper - lower) * 0.5f;
+                count = model.instances.size();
+            }
+
+            glm::mat4 modelMatrix = glm::translate(glm::vec3(model.x, model.y, model.z))
+                * glm::rotate(model.angle, glm::vec3(0.0f, 1.0f, 0.0f));
+            glm::vec3 worldCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.0f));
+            size_t lod = selectLod(worldCenter, radius, loader->getLodCount(), cameraPosition, projectionScale);
+            objects += count;
+            fullTriangles += loader->getLodFaceCount(0) * count;
+            lodTriangles += loader->getLodFaceCount(lod) * count;
+            objectsPerLod[lod] += count;
+        }
+
+        printf("%s: %zu objects, %zu meshes\n", filePath.c_str(), objects, meshes.size());
+        printf("  %12zu triangles per frame without LODs\n", fullTriangles);
+        printf("  %12zu triangles per frame with LODs (%.1f%%)\n", lodTriangles,
+            fullTriangles > 0 ? 100.0 * lodTriangles / fullTriangles : 100.0);
+        for (size_t lod = 0; lod < MaxMeshLods; lod++) {
+            if (objectsPerLod[lod] > 0) {
+                printf("  LOD %zu: %zu objects\n", lod, objectsPerLod[lod]);
+            }
+        }
+    }
+    return 0;
+}
+
+static void usage() {
+    std::cerr << "Usage: Benchmarks <benchmark> [options]" << std::endl
+              << "  parse [file.obj ...] [--triangles N]   OBJ parse throughput" << std::endl
+              << "  parallel [file.obj ...] [--triangles N] serial vs threaded parse, checks identical output" << std::endl
+              << "  cache [file.obj ...] [--triangles N]   text vs .meshbin startup" << std::endl
+              << "  optimize [file.obj ...]                ACMR/ATVR before and after optimization" << std::endl
+              << "  quantize [file.obj ...]                packed vertex size and reconstruction error" << std::endl
+              << "  level [file.json] [--models N]         SAX vs DOM vs cooked .lvlbin level load" << std::endl
+              << "  instances [--count N]                  writes N teapots as separate and instanced levels" << std::endl
+              << "  transforms [--count N ...]             per-object glm vs batched SoA model and normal matrices" << std::endl
+              << "  variants [level.json ...]              shader variants a level compiles" << std::endl
+              << "  sort [--count N ...]                   draw list radix sort vs std::stable_sort, binds saved" << std::endl
+              << "  lods [level.json ...]                  triangles per frame with and without LODs" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::string benchmark = argv[1];
+    if (benchmark == "parse") {
+        return runParse(argc - 2, argv + 2);
+    }
+    if (benchmark == "parallel") {
+        return runParallel(argc - 2, argv + 2);
+    }
+    if (benchmark == "cache") {
+        return runCache(argc - 2, argv + 2);
+    }
+    if (benchmark == "optimize") {
+        return runOptimize(argc - 2, argv + 2);
+    }
+    if (benchmark == "quantize") {
+        return runQuantize(argc - 2, argv + 2);
+    }
+    if (benchmark == "level") {
+        return runLevel(argc - 2, argv + 2);
+    }
+    if (benchmark == "instances") {
+        return runInstances(argc - 2, argv + 2);
+    }
+    if (benchmark == "transforms") {
+        return runTransforms(argc - 2, argv + 2);
+    }
+    if (benchmark == "variants") {
+        return runVariants(argc - 2, argv + 2);
+    }
+    if (benchmark == "sort") {
+        return runSort(argc - 2, argv + 2);
+    }
+    if (benchmark == "lods") {
+        return runLods(argc - 2, argv + 2);
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,65 @@
+// Compiles a level JSON file into the binary .lvlbin layout that LvlLoader
+// reads in place. The JSON file stays the authoring format.
+//
+// Usage:
+//   LevelCooker level.json [level.lvlbin]
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "../common/light.hpp"
+#include "../common/lvlparser.hpp"
+#include "../common/lvlbin.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static size_t fileSize(const std::string& filePath) {
+    struct stat st;
+    if (stat(filePath.c_str(), &st) != 0) {
+        return 0;
+    }
+    return (size_t)st.st_size;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: LevelCooker level.json [level.lvlbin]" << std::endl;
+        return 1;
+    }
+
+    std::string inputPath = argv[1];
+    std::string outputPath;
+    if (argc == 3) {
+        outputPath = argv[2];
+    } else {
+        size_t dot = inputPath.find_last_of('.');
+        size_t slash = inputPath.find_last_of('/');
+        bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+        outputPath = (hasExtension ? inputPath.substr(0, dot) : inputPath) + ".lvlbin";
+    }
+
+    Clock::time_point start = Clock::now();
+    LevelData level;
+    if (!parseLevel(inputPath, level)) {
+        return 1;
+    }
+    level.applyRetention();
+    if (!writeLevelBin(outputPath, level.name, level.models, level.lights)) {
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    size_t loaded = 0;
+    for (const LevelModel& model : level.models) {
+        loaded += model.load ? 1 : 0;
+    }
+    printf("%s -> %s: %zu models (%zu skipped), %zu lights, %.1f KB -> %.1f KB in %.1f ms\n",
+        inputPath.c_str(), outputPath.c_str(), loaded, level.models.size() - loaded, level.lights.size(),
+        fileSize(inputPath) / 1024.0, fileSize(outputPath) / 1024.0, ms);
+    return 0;
+}
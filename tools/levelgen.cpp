@@ -0,0 +1,381 @@
+// Writes procedural stress levels in the standard level JSON format, for
+// measuring how loading and rendering scale with the object count. The
+// same options and seed always produce the same file, on any platform:
+// random numbers come from integer arithmetic and the placement only uses
+// IEEE basic operations, no libm functions.
+//
+// Usage:
+//   LevelGen [level.json] [--objects N] [--lights N] [--mesh file.obj[:weight] ...]
+//            [--distribution grid|uniform|clusters] [--spacing F] [--seed S] [--instanced]
+//            [--lods R,R,...]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../rapidjson/filewritestream.h"
+#include "../rapidjson/writer.h"
+
+#include "../common/light.hpp"
+
+static const double Pi = 3.14159265358979323846;
+
+// splitmix64, so the output does not depend on the standard library's
+// random engines or distributions
+class Random {
+public:
+    Random(uint64_t seed) : _state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1)
+    double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    double uniform(double low, double high) {
+        return low + (high - low) * uniform();
+    }
+
+    // Approximately standard normal: the sum of twelve uniforms has mean 6
+    // and variance 1. Summed as 32-bit integers, so the result is exact.
+    double normal() {
+        uint64_t sum = 0;
+        for (int i = 0; i < 12; i++) {
+            sum += next() >> 32;
+        }
+        return ((double)sum - 6.0 * 4294967296.0) * (1.0 / 4294967296.0);
+    }
+private:
+    uint64_t _state;
+};
+
+enum Distribution {
+    DistributionGrid,
+    DistributionUniform,
+    DistributionClusters
+};
+
+struct MeshChoice {
+    std::string fileName;
+    double weight;
+};
+
+struct Placement {
+    size_t mesh;
+    double x, y, z;
+    double angle;
+    double color[3];
+};
+
+typedef rapidjson::Writer<rapidjson::FileWriteStream> JsonWriter;
+
+static void writeVec3(JsonWriter& writer, double x, double y, double z) {
+    writer.StartArray();
+    writer.Double(x);
+    writer.Double(y);
+    writer.Double(z);
+    writer.EndArray();
+}
+
+static bool parseDistribution(const std::string& value, Distribution& distribution) {
+    if (value == "grid") {
+        distribution = DistributionGrid;
+    } else if (value == "uniform") {
+        distribution = DistributionUniform;
+    } else if (value == "clusters") {
+        distribution = DistributionClusters;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "file.obj" or "file.obj:weight"
+static bool parseMeshChoice(const std::string& value, MeshChoice& choice) {
+    choice.fileName = value;
+    choice.weight = 1.0;
+    size_t colon = value.find_last_of(':');
+    if (colon != std::string::npos) {
+        choice.fileName = value.substr(0, colon);
+        choice.weight = strtod(value.c_str() + colon + 1, nullptr);
+    }
+    return !choice.fileName.empty() && choice.weight > 0.0;
+}
+
+// "0.5,0.25,0.1", each ratio in (0, 1)
+static bool parseLodRatios(const std::string& value, std::vector<double>& ratios) {
+    ratios.clear();
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        if (comma == std::string::npos) {
+            comma = value.size();
+        }
+        double ratio = strtod(value.substr(start, comma - start).c_str(), nullptr);
+        if (ratio <= 0.0 || ratio >= 1.0) {
+            return false;
+        }
+        ratios.push_back(ratio);
+        start = comma + 1;
+    }
+    return true;
+}
+
+static void usage() {
+    std::cerr << "Usage: LevelGen [level.json] [options]" << std::endl
+              << "  --objects N          objects to place (default 100)" << std::endl
+              << "  --lights N           lights to place (default 4)" << std::endl
+              << "  --mesh file[:weight] mesh to place, repeat for a mix (default ../teapot.obj and ../cube-test.obj)" << std::endl
+              << "  --distribution D     grid, uniform or clusters (default grid)" << std::endl
+              << "  --spacing F          average distance between objects (default 3)" << std::endl
+              << "  --seed S             random seed (default 1)" << std::endl
+              << "  --instanced          one instanced model entry per mesh instead of one entry per object" << std::endl
+              << "  --lods R,R,...       simplified levels of detail for every model, e.g. 0.5,0.25,0.1" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string outputPath;
+    size_t objects = 100;
+    size_t lights = 4;
+    std::vector<MeshChoice> meshes;
+    Distribution distribution = DistributionGrid;
+    double spacing = 3.0;
+    uint64_t seed = 1;
+    bool instanced = false;
+    std::vector<double> lodRatios;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--objects") == 0 && hasValue) {
+            objects = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--lights") == 0 && hasValue) {
+            lights = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--mesh") == 0 && hasValue) {
+            MeshChoice choice;
+            if (!parseMeshChoice(argv[++i], choice)) {
+                std::cerr << "Invalid mesh: " << argv[i] << std::endl;
+                return 1;
+            }
+            meshes.push_back(choice);
+        } else if (strcmp(argv[i], "--distribution") == 0 && hasValue) {
+            if (!parseDistribution(argv[++i], distribution)) {
+                std::cerr << "Unknown distribution: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--spacing") == 0 && hasValue) {
+            spacing = strtod(argv[++i], nullptr);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--instanced") == 0) {
+            instanced = true;
+        } else if (strcmp(argv[i], "--lods") == 0 && hasValue) {
+            if (!parseLodRatios(argv[++i], lodRatios)) {
+                std::cerr << "Invalid LOD ratios: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 1;
+        } else {
+            outputPath = argv[i];
+        }
+    }
+    if (meshes.empty()) {
+        MeshChoice teapot = { "../teapot.obj", 1.0 };
+        MeshChoice cube = { "../cube-test.obj", 1.0 };
+        meshes.push_back(teapot);
+        meshes.push_back(cube);
+    }
+    if (outputPath.empty()) {
+        outputPath = "stress_" + std::to_string(objects) + (instanced ? "_instanced" : "")
+            + (lodRatios.empty() ? "" : "_lods") + ".json";
+    }
+    if (lights > (size_t)MaxLights) {
+        std::cerr << "Note: the fragment shader lights with the first " << MaxLights << " lights only" << std::endl;
+    }
+
+    double totalWeight = 0.0;
+    for (const MeshChoice& mesh : meshes) {
+        totalWeight += mesh.weight;
+    }
+
+    // Objects cover a square about spacing * sqrt(objects) wide, centered
+    // on the origin in front of the default camera
+    Random random(seed);
+    size_t side = 1;
+    while (side * side < objects) {
+        side++;
+    }
+    double extent = spacing * side;
+    std::vector<double> clusterX;
+    std::vector<double> clusterZ;
+    if (distribution == DistributionClusters) {
+        size_t clusters = side / 4 + 1;
+        for (size_t i = 0; i < clusters; i++) {
+            clusterX.push_back(random.uniform(-0.5, 0.5) * extent);
+            clusterZ.push_back(random.uniform(-0.5, 0.5) * extent);
+        }
+    }
+
+    std::vector<Placement> placements(objects);
+    for (size_t i = 0; i < objects; i++) {
+        Placement& placement = placements[i];
+        double pick = random.uniform() * totalWeight;
+        placement.mesh = 0;
+        while (placement.mesh + 1 < meshes.size() && pick >= meshes[placement.mesh].weight) {
+            pick -= meshes[placement.mesh].weight;
+            placement.mesh++;
+        }
+
+        placement.y = 0.0;
+        if (distribution == DistributionGrid) {
+            placement.x = ((double)(i % side) - 0.5 * (side - 1)) * spacing;
+            placement.z = -((double)(i / side) + 1.0) * spacing;
+        } else if (distribution == DistributionUniform) {
+            placement.x = random.uniform(-0.5, 0.5) * extent;
+            placement.z = -random.uniform(0.0, 1.0) * extent - spacing;
+        } else {
+            size_t cluster = (size_t)(random.uniform() * clusterX.size());
+            double radius = extent / (2.0 * clusterX.size());
+            placement.x = clusterX[cluster] + random.normal() * radius;
+            placement.z = clusterZ[cluster] - 0.5 * extent - spacing + random.normal() * radius;
+        }
+        placement.angle = random.uniform(0.0, 2.0 * Pi);
+        for (int c = 0; c < 3; c++) {
+            placement.color[c] = random.uniform(0.2, 1.0);
+        }
+    }
+
+    FILE* file = fopen(outputPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error opening file: " << outputPath << std::endl;
+        return 1;
+    }
+    char buffer[65536];
+    rapidjson::FileWriteStream stream(file, buffer, sizeof(buffer));
+    JsonWriter writer(stream);
+    writer.SetMaxDecimalPlaces(3);
+
+    std::string name = "Stress_" + std::to_string(objects);
+    writer.StartObject();
+    writer.Key("Name");
+    writer.String(name.c_str());
+    writer.Key("Description");
+    std::string description = "LevelGen seed " + std::to_string(seed);
+    writer.String(description.c_str());
+    writer.Key("MeshRetention");
+    writer.String("Bounds");
+
+    writer.Key("Lights");
+    writer.StartArray();
+    for (size_t i = 0; i < lights; i++) {
+        writer.StartObject();
+        writer.Key("Position");
+        writeVec3(writer, random.uniform(-0.5, 0.5) * extent, random.uniform(2.0, 6.0), -random.uniform(0.0, 1.0) * extent);
+        writer.Key("Color");
+        writeVec3(writer, random.uniform(0.5, 1.0), random.uniform(0.5, 1.0), random.uniform(0.5, 1.0));
+        writer.Key("Intensity");
+        writer.Double(random.uniform(0.05, 0.2));
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.Key("Models");
+    writer.StartArray();
+    for (size_t mesh = 0; mesh < meshes.size(); mesh++) {
+        size_t placed = 0;
+        for (size_t i = 0; i < objects; i++) {
+            const Placement& placement = placements[i];
+            if (placement.mesh != mesh) {
+                continue;
+            }
+
+            // Instanced levels write the model entry once per mesh, then
+            // only the per-instance fields
+            if (instanced && placed++ > 0) {
+                writer.StartObject();
+                writer.Key("Location");
+                writeVec3(writer, placement.x, placement.y, placement.z);
+                writer.Key("Angle");
+                writer.Double(placement.angle);
+                writer.Key("Color");
+                writeVec3(writer, placement.color[0], placement.color[1], placement.color[2]);
+                writer.EndObject();
+                continue;
+            }
+
+            writer.StartObject();
+            writer.Key("FileName");
+            writer.String(meshes[mesh].fileName.c_str());
+            writer.Key("FragmentShader");
+            writer.String("../SimpleFragmentShader.glsl");
+            writer.Key("VertexShader");
+            writer.String("../SimpleVertexShader.glsl");
+            writer.Key("LocationX");
+            writer.Double(instanced ? 0.0 : placement.x);
+            writer.Key("LocationY");
+            writer.Double(instanced ? 0.0 : placement.y);
+            writer.Key("LocationZ");
+            writer.Double(instanced ? 0.0 : placement.z);
+            writer.Key("Angle");
+            writer.Double(instanced ? 0.0 : placement.angle);
+            writer.Key("Color");
+            if (instanced) {
+                writeVec3(writer, 1.0, 1.0, 1.0);
+            } else {
+                writeVec3(writer, placement.color[0], placement.color[1], placement.color[2]);
+            }
+            writer.Key("LoadObject");
+            writer.Bool(true);
+            if (!lodRatios.empty()) {
+                writer.Key("LODs");
+                writer.StartArray();
+                for (double ratio : lodRatios) {
+                    writer.Double(ratio);
+                }
+                writer.EndArray();
+            }
+            if (!instanced) {
+                writer.EndObject();
+                continue;
+            }
+
+            writer.Key("Instances");
+            writer.StartArray();
+            writer.StartObject();
+            writer.Key("Location");
+            writeVec3(writer, placement.x, placement.y, placement.z);
+            writer.Key("Angle");
+            writer.Double(placement.angle);
+            writer.Key("Color");
+            writeVec3(writer, placement.color[0], placement.color[1], placement.color[2]);
+            writer.EndObject();
+        }
+        if (instanced && placed > 0) {
+            writer.EndArray();
+            writer.EndObject();
+        }
+    }
+    writer.EndArray();
+    writer.EndObject();
+    stream.Flush();
+
+    bool ok = writer.IsComplete() && !ferror(file);
+    if (fclose(file) != 0 || !ok) {
+        std::cerr << "Error writing file: " << outputPath << std::endl;
+        return 1;
+    }
+
+    printf("%s: %zu objects, %zu lights, %zu meshes, seed %llu\n", outputPath.c_str(), objects, lights,
+        meshes.size(), (unsigned long long)seed);
+    return 0;
+}